@@ -0,0 +1,184 @@
+//
+//  BandBank.cpp
+//  SimpleEQ
+//
+
+#include "BandBank.h"
+
+juce::StringArray getBandTypeNames()
+{
+    return { "Bell", "Low Shelf", "High Shelf", "Notch", "Tilt", "Low Cut", "High Cut" };
+}
+
+juce::String getBandParameterID(int bandIndex, const juce::String& name)
+{
+    return "Band" + juce::String(bandIndex + 1) + " " + name;
+}
+
+void BandParameters::attachTo(juce::AudioProcessorValueTreeState& apvts, int bandIndex)
+{
+    type = apvts.getRawParameterValue(getBandParameterID(bandIndex, "Type"));
+    freq = apvts.getRawParameterValue(getBandParameterID(bandIndex, "Freq"));
+    gain = apvts.getRawParameterValue(getBandParameterID(bandIndex, "Gain"));
+    quality = apvts.getRawParameterValue(getBandParameterID(bandIndex, "Quality"));
+    bypassed = apvts.getRawParameterValue(getBandParameterID(bandIndex, "Bypassed"));
+    
+    jassert(type != nullptr && freq != nullptr && gain != nullptr && quality != nullptr && bypassed != nullptr);
+}
+
+BandSettings BandParameters::load() const
+{
+    BandSettings settings;
+    
+    settings.type = static_cast<BandType>(type->load());
+    settings.freq = freq->load();
+    settings.gainInDecibels = gain->load();
+    settings.quality = quality->load();
+    settings.bypassed = bypassed->load() > 0.5f;
+    
+    return settings;
+}
+
+//==============================================================================
+void BandBank::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    
+    for( int i = 0; i < maxBands; ++i )
+        design(i);
+    
+    reset();
+}
+
+void BandBank::reset()
+{
+    for( int ch = 0; ch < maxChannels; ++ch )
+    {
+        z1[ch].fill(0.f);
+        z2[ch].fill(0.f);
+    }
+}
+
+void BandBank::setBand(int bandIndex, const BandSettings& newSettings)
+{
+    jassert(juce::isPositiveAndBelow(bandIndex, maxBands));
+    
+    auto& current = settings[bandIndex];
+    if( newSettings == current )
+        return;
+    
+    const auto wasBypassed = current.bypassed;
+    current = newSettings;
+    
+    if( wasBypassed && !current.bypassed )
+    {
+        // don't resume from whatever state the band had when it was switched off
+        for( int ch = 0; ch < maxChannels; ++ch )
+        {
+            z1[ch][bandIndex] = 0.f;
+            z2[ch][bandIndex] = 0.f;
+        }
+    }
+    
+    design(bandIndex);
+    
+    if( wasBypassed != current.bypassed )
+        updateActiveBands();
+}
+
+void BandBank::updateActiveBands()
+{
+    numActiveBands = 0;
+    
+    for( int i = 0; i < maxBands; ++i )
+    {
+        if( !settings[i].bypassed )
+            activeBands[numActiveBands++] = i;
+    }
+}
+
+void BandBank::design(int bandIndex)
+{
+    using namespace juce;
+    using ArrayCoefficients = dsp::IIR::ArrayCoefficients<float>;
+    
+    const auto& band = settings[bandIndex];
+    
+    if( sampleRate <= 0.0 )
+    {
+        // not prepared yet, pass the signal through unchanged
+        b0[bandIndex] = 1.f;
+        b1[bandIndex] = b2[bandIndex] = a1[bandIndex] = a2[bandIndex] = 0.f;
+        return;
+    }
+    
+    const auto freq = jlimit(10.f, float(sampleRate * 0.49), band.freq);
+    const auto quality = jmax(0.025f, band.quality);
+    const auto gain = Decibels::decibelsToGain(band.gainInDecibels);
+    auto outputGain = 1.f;
+    
+    std::array<float, 6> c;
+    
+    switch( band.type )
+    {
+        case BandType::Bell:
+            c = ArrayCoefficients::makePeakFilter(sampleRate, freq, quality, gain);
+            break;
+        case BandType::LowShelf:
+            c = ArrayCoefficients::makeLowShelf(sampleRate, freq, quality, gain);
+            break;
+        case BandType::HighShelf:
+            c = ArrayCoefficients::makeHighShelf(sampleRate, freq, quality, gain);
+            break;
+        case BandType::Notch:
+            c = ArrayCoefficients::makeNotch(sampleRate, freq, quality);
+            break;
+        case BandType::Tilt:
+            // a high shelf pulled down by half its gain pivots around freq
+            c = ArrayCoefficients::makeHighShelf(sampleRate, freq, quality, gain);
+            outputGain = Decibels::decibelsToGain(-0.5f * band.gainInDecibels);
+            break;
+        case BandType::LowCut:
+            c = ArrayCoefficients::makeHighPass(sampleRate, freq, quality);
+            break;
+        case BandType::HighCut:
+            c = ArrayCoefficients::makeLowPass(sampleRate, freq, quality);
+            break;
+    }
+    
+    // c is b0, b1, b2, a0, a1, a2
+    const auto a0Inverse = 1.f / c[3];
+    
+    b0[bandIndex] = c[0] * a0Inverse * outputGain;
+    b1[bandIndex] = c[1] * a0Inverse * outputGain;
+    b2[bandIndex] = c[2] * a0Inverse * outputGain;
+    a1[bandIndex] = c[4] * a0Inverse;
+    a2[bandIndex] = c[5] * a0Inverse;
+}
+
+std::array<float, 5> BandBank::getActiveBandCoefficients(int activeIndex) const
+{
+    jassert(juce::isPositiveAndBelow(activeIndex, numActiveBands));
+    
+    const auto band = activeBands[activeIndex];
+    return { b0[band], b1[band], b2[band], a1[band], a2[band] };
+}
+
+void BandBank::process(juce::AudioBuffer<float>& buffer)
+{
+    const auto numChannels = juce::jmin(buffer.getNumChannels(), maxChannels);
+    const auto numSamples = buffer.getNumSamples();
+    
+    if( numActiveBands == 0 || numChannels == 0 )
+        return;
+    
+    auto* left = buffer.getWritePointer(0);
+    auto* right = numChannels > 1 ? buffer.getWritePointer(1) : nullptr;
+    
+    const DspKernels::BiquadBank bank { b0.data(), b1.data(), b2.data(), a1.data(), a2.data(),
+                                        { z1[0].data(), z1[1].data() },
+                                        { z2[0].data(), z2[1].data() },
+                                        activeBands.data(), numActiveBands };
+    
+    kernels->processBiquadBank(bank, left, right, numSamples);
+}
@@ -0,0 +1,101 @@
+//
+//  BandBank.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "DspKernels.h"
+
+enum class BandType
+{
+    Bell,
+    LowShelf,
+    HighShelf,
+    Notch,
+    Tilt,
+    LowCut,
+    HighCut
+};
+
+juce::StringArray getBandTypeNames();
+
+struct BandSettings
+{
+    BandType type { BandType::Bell };
+    float freq { 1000.f }, gainInDecibels { 0.f }, quality { 1.f };
+    bool bypassed { true };
+    
+    bool operator==(const BandSettings& other) const
+    {
+        return type == other.type
+            && freq == other.freq
+            && gainInDecibels == other.gainInDecibels
+            && quality == other.quality
+            && bypassed == other.bypassed;
+    }
+    
+    bool operator!=(const BandSettings& other) const { return !(*this == other); }
+};
+
+/** "Band<n> <name>", with bands numbered from 1. */
+juce::String getBandParameterID(int bandIndex, const juce::String& name);
+
+/** Caches one band's raw parameter pointers so neither the audio thread nor the display looks them up by ID. */
+struct BandParameters
+{
+    void attachTo(juce::AudioProcessorValueTreeState& apvts, int bandIndex);
+    BandSettings load() const;
+private:
+    std::atomic<float>* type = nullptr;
+    std::atomic<float>* freq = nullptr;
+    std::atomic<float>* gain = nullptr;
+    std::atomic<float>* quality = nullptr;
+    std::atomic<float>* bypassed = nullptr;
+};
+
+/**
+ A bank of up to maxBands biquads, processed in series after the fixed low-cut/peak/high-cut chain.
+
+ Coefficients and filter state are stored as structure-of-arrays indexed by band. A band is only
+ redesigned when its settings change, and bypassed bands are skipped entirely, so the cost
+ scales with the number of active bands rather than maxBands.
+ */
+struct BandBank
+{
+    static constexpr int maxBands = 24;
+    static constexpr int maxChannels = 2;
+    
+    void prepare(double sampleRate);
+    void reset();
+    
+    double getSampleRate() const { return sampleRate; }
+    
+    /** Redesigns the band if its settings changed. */
+    void setBand(int bandIndex, const BandSettings& newSettings);
+    
+    /** Processes the first two channels in place. */
+    void process(juce::AudioBuffer<float>& buffer);
+    
+    int getNumActiveBands() const { return numActiveBands; }
+    
+    /** Normalised coefficients b0, b1, b2, a1, a2 of the n-th active band. */
+    std::array<float, 5> getActiveBandCoefficients(int activeIndex) const;
+private:
+    double sampleRate = 44100.0;
+    
+    std::array<BandSettings, maxBands> settings;
+    
+    std::array<float, maxBands> b0 {}, b1 {}, b2 {}, a1 {}, a2 {};
+    std::array<std::array<float, maxBands>, maxChannels> z1 {}, z2 {};
+    
+    std::array<int, maxBands> activeBands {};
+    int numActiveBands = 0;
+    
+    const DspKernels::KernelTable* kernels = &DspKernels::getKernels();
+    
+    void design(int bandIndex);
+    void updateActiveBands();
+};
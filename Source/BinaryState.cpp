@@ -0,0 +1,96 @@
+//
+//  BinaryState.cpp
+//  SimpleEQ
+//
+
+#include "BinaryState.h"
+
+namespace BinaryState
+{
+    constexpr int headerSize = 4 + 2 + 2 + 4;
+    
+    /** Version 1's "Filter Engine" had two choices, so they sat at 0 and 1 rather than 0 and 0.5. */
+    void migrateFromVersion1(std::vector<float>& values, const juce::Array<juce::AudioProcessorParameter*>& parameters)
+    {
+        for( int i = 0; i < parameters.size(); ++i )
+        {
+            auto* choice = dynamic_cast<juce::AudioParameterChoice*>(parameters[i]);
+            
+            if( choice != nullptr && choice->paramID == "Filter Engine" )
+            {
+                const auto index = values[(size_t)i] > 0.5f ? 1.f : 0.f;
+                values[(size_t)i] = choice->convertTo0to1(index);
+            }
+        }
+    }
+    
+    juce::uint32 getLayoutHash(const juce::Array<juce::AudioProcessorParameter*>& parameters)
+    {
+        juce::String ids;
+        
+        for( auto* parameter : parameters )
+        {
+            if( auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter) )
+                ids << withID->paramID;
+            
+            ids << ';';
+        }
+        
+        return (juce::uint32)ids.hashCode();
+    }
+    
+    void write(const juce::Array<juce::AudioProcessorParameter*>& parameters, juce::MemoryBlock& destData)
+    {
+        juce::MemoryOutputStream mos(destData, true);
+        
+        mos.writeInt((int)magic);
+        mos.writeShort((short)version);
+        mos.writeShort((short)parameters.size());
+        mos.writeInt((int)getLayoutHash(parameters));
+        
+        for( auto* parameter : parameters )
+            mos.writeFloat(parameter->getValue());
+    }
+    
+    bool read(const void* data, int sizeInBytes, const juce::Array<juce::AudioProcessorParameter*>& parameters)
+    {
+        if( data == nullptr || sizeInBytes < headerSize )
+            return false;
+        
+        juce::MemoryInputStream mis(data, (size_t)sizeInBytes, false);
+        
+        if( (juce::uint32)mis.readInt() != magic )
+            return false;
+        
+        const auto blobVersion = (juce::uint16)mis.readShort();
+        const auto numParameters = (int)(juce::uint16)mis.readShort();
+        const auto layoutHash = (juce::uint32)mis.readInt();
+        
+        if( blobVersion < 1 || blobVersion > version
+           || numParameters != parameters.size()
+           || layoutHash != getLayoutHash(parameters)
+           || sizeInBytes < headerSize + numParameters * (int)sizeof(float) )
+        {
+            jassertfalse; // a blob from another layout, it needs a migration
+            return false;
+        }
+        
+        std::vector<float> values((size_t)numParameters);
+        
+        for( auto& value : values )
+            value = juce::jlimit(0.f, 1.f, mis.readFloat());
+        
+        if( blobVersion == 1 )
+            migrateFromVersion1(values, parameters);
+        
+        for( int i = 0; i < numParameters; ++i )
+        {
+            auto* parameter = parameters[i];
+            
+            if( values[(size_t)i] != parameter->getValue() )
+                parameter->setValueNotifyingHost(values[(size_t)i]);
+        }
+        
+        return true;
+    }
+}
@@ -0,0 +1,39 @@
+//
+//  BinaryState.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ The plugin state as a fixed header followed by every parameter's normalised value as a
+ little-endian float, in getParameters() order.
+ 
+ The header holds a magic number, the format version and a hash of the parameter IDs in order.
+ Reading fails (and the caller falls back to the ValueTree form) unless the hash matches this
+ build's layout. Any change to the parameter list must therefore bump version and add a migration
+ from the old layout here.
+ */
+namespace BinaryState
+{
+    constexpr juce::uint32 magic = 0x42514553; // "SEQB"
+    /**
+     1: the first layout.
+     2: "Filter Engine" gained a third choice, "Auto", so its normalised values moved.
+     */
+    constexpr juce::uint16 version = 2;
+    
+    juce::uint32 getLayoutHash(const juce::Array<juce::AudioProcessorParameter*>& parameters);
+    
+    void write(const juce::Array<juce::AudioProcessorParameter*>& parameters, juce::MemoryBlock& destData);
+    
+    /**
+     Restores the parameters from data if it holds a blob for this layout. Only parameters whose
+     value differs are set, so restoring an unchanged or mostly default state notifies almost
+     nothing. Blobs from older versions are migrated. Returns false, touching nothing, if data
+     isn't in this format.
+     */
+    bool read(const void* data, int sizeInBytes, const juce::Array<juce::AudioProcessorParameter*>& parameters);
+}
@@ -0,0 +1,104 @@
+//
+//  CoefficientDesign.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include "FastMath.h"
+
+/** b0, b1, b2, a1, a2, normalised so that a0 == 1. */
+using BiquadCoefficients = std::array<float, 5>;
+
+namespace Butterworth
+{
+    constexpr int maxSections = 4;
+    
+    /**
+     Q of each biquad of an even-order Butterworth filter, 1 / (2cos((2i + 1) pi / 2N)),
+     indexed by [order / 2 - 1][i]. The sections are in the same order as juce's designs.
+     */
+    constexpr float qualities[maxSections][maxSections]
+    {
+        { 0.70710678f },
+        { 0.54119610f, 1.30656296f },
+        { 0.51763809f, 0.70710678f, 1.93185165f },
+        { 0.50979558f, 0.60134489f, 0.89997622f, 2.56291545f },
+    };
+    
+    /** 1 / Q, the damping a state-variable section is tuned with. */
+    constexpr float getDamping(int numSections, int section)
+    {
+        return 1.f / qualities[numSections - 1][section];
+    }
+    
+    static_assert(getDamping(1, 0) > 1.414f && getDamping(1, 0) < 1.4143f);
+}
+
+using CutFilterDesign = std::array<BiquadCoefficients, Butterworth::maxSections>;
+
+/** K = tan(pi f / fs), the bilinear transform's prewarped frequency. */
+inline float prewarpFrequency(float freq, double sampleRate)
+{
+    constexpr float pi = 3.14159265f;
+    const auto limited = std::min(freq, float(sampleRate * 0.49));
+    return FastMath::tan(pi * limited / float(sampleRate));
+}
+
+/**
+ Designs an even-order Butterworth high-pass or low-pass cascade into design.
+ The whole cascade costs one tan and never allocates. Returns the number of sections used.
+ */
+inline int designButterworthCut(bool isHighPass, float freq, double sampleRate, int order, CutFilterDesign& design)
+{
+    const auto numSections = std::clamp(order / 2, 1, Butterworth::maxSections);
+    
+    const auto K = prewarpFrequency(freq, sampleRate);
+    const auto KSquared = K * K;
+    
+    for( int i = 0; i < numSections; ++i )
+    {
+        const auto KOverQ = K * Butterworth::getDamping(numSections, i);
+        const auto norm = 1.f / (1.f + KOverQ + KSquared);
+        
+        const auto b0 = isHighPass ? norm : KSquared * norm;
+        
+        design[i] = { b0,
+                      isHighPass ? -2.f * b0 : 2.f * b0,
+                      b0,
+                      2.f * (KSquared - 1.f) * norm,
+                      (1.f - KOverQ + KSquared) * norm };
+    }
+    
+    return numSections;
+}
+
+/**
+ The RBJ peak filter, identical to juce::dsp::IIR::Coefficients::makePeakFilter.
+ sin(w) and cos(w) are derived from t = tan(w / 2), so it also costs a single tan.
+ */
+inline BiquadCoefficients designPeak(float freq, float quality, float gainInDecibels, double sampleRate)
+{
+    const auto t = prewarpFrequency(freq, sampleRate);
+    const auto inverseOnePlusTSquared = 1.f / (1.f + t * t);
+    
+    const auto sinW = 2.f * t * inverseOnePlusTSquared;
+    const auto cosW = (1.f - t * t) * inverseOnePlusTSquared;
+    
+    const auto A = std::pow(10.f, gainInDecibels / 40.f);
+    const auto alpha = sinW / (2.f * quality);
+    const auto alphaTimesA = alpha * A;
+    const auto alphaOverA = alpha / A;
+    
+    const auto inverseA0 = 1.f / (1.f + alphaOverA);
+    const auto c2 = -2.f * cosW * inverseA0;
+    
+    return { (1.f + alphaTimesA) * inverseA0,
+             c2,
+             (1.f - alphaTimesA) * inverseA0,
+             c2,
+             (1.f - alphaOverA) * inverseA0 };
+}
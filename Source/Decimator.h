@@ -0,0 +1,198 @@
+//
+//  Decimator.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ Band-limits a signal and keeps every Nth sample, for analysis only, so phase doesn't matter.
+
+ A general factor uses an 8th order Butterworth low-pass. Decimating to the display range uses a
+ cascade of 2x halfband FIR stages instead, which are steep enough to take 88.2k/96k down to
+ 44.1k/48k while staying flat to 20 kHz.
+ */
+struct Decimator
+{
+    /**
+     The display runs to 20 kHz, so the decimated rate never goes below 44.1 kHz. Each halfband
+     stage passes 20 kHz and rejects everything that would fold below it, which at a 44.1k
+     output leaves a transition band of only 20 kHz to 24.1 kHz. Kaiser designs for 90 dB keep
+     20 kHz within 0.002 dB, and anything that would alias into the display at least 85 dB down.
+     */
+    static constexpr double minDisplayRangeSampleRate = 44100.0;
+    static constexpr double displayRangePassband = 20000.0;
+    static constexpr float halfbandAttenuationDb = 90.f;
+    
+    /**
+     The largest power-of-two factor that keeps the decimated rate at or above
+     minDisplayRangeSampleRate, so the analyzer always runs at 44.1k or 48k: 2 at 88.2k/96k, 4 at
+     176.4k/192k and 8 at 352.8k/384k.
+     */
+    static int getFactorForDisplayRange(double sampleRate)
+    {
+        int factor = 1;
+        
+        while( sampleRate / (factor * 2.0) >= minDisplayRangeSampleRate )
+            factor *= 2;
+        
+        return factor;
+    }
+    
+    /** Prepares to decimate by getFactorForDisplayRange() through halfband stages. */
+    void prepareForDisplayRange(double inputSampleRate)
+    {
+        factor = getFactorForDisplayRange(inputSampleRate);
+        phase = 0;
+        halfbands.clear();
+        
+        auto stageRate = inputSampleRate;
+        
+        for( int remaining = factor; remaining > 1; remaining /= 2 )
+        {
+            // symmetric about a quarter of the stage's rate: pass up to 20k, stop where aliases would land below it
+            const auto transitionWidth = float((stageRate * 0.5 - 2.0 * displayRangePassband) / stageRate);
+            auto coefficients = juce::dsp::FilterDesign<float>::designFIRLowpassKaiserMethod(float(stageRate * 0.25),
+                                                                                            stageRate,
+                                                                                            transitionWidth,
+                                                                                            halfbandAttenuationDb);
+            halfbands.emplace_back().prepare(coefficients->coefficients);
+            stageRate *= 0.5;
+        }
+    }
+    
+    /** cutoffFraction is the low-pass cutoff relative to the decimated Nyquist. */
+    void prepare(double inputSampleRate, int decimationFactor, double cutoffFraction = 0.8)
+    {
+        jassert(decimationFactor >= 1);
+        factor = decimationFactor;
+        phase = 0;
+        halfbands.clear();
+        
+        if( factor == 1 )
+            return;
+        
+        auto outputNyquist = inputSampleRate / factor * 0.5;
+        auto coefficients = juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(cutoffFraction * outputNyquist,
+                                                                                                        inputSampleRate,
+                                                                                                        2 * (int)lowpass.size());
+        jassert(coefficients.size() == (int)lowpass.size());
+        
+        for( size_t i = 0; i < lowpass.size(); ++i )
+        {
+            lowpass[i].coefficients = coefficients[(int)i];
+            lowpass[i].reset();
+        }
+    }
+    
+    /** Returns the number of samples written to output, at most numSamples / factor + 1. */
+    int process(const float* input, int numSamples, float* output)
+    {
+        if( factor == 1 )
+        {
+            std::copy(input, input + numSamples, output);
+            return numSamples;
+        }
+        
+        if( !halfbands.empty() )
+        {
+            // each stage writes no further than it has read, so the later ones can work in place
+            auto* source = input;
+            
+            for( auto& stage : halfbands )
+            {
+                numSamples = stage.process(source, numSamples, output);
+                source = output;
+            }
+            
+            return numSamples;
+        }
+        
+        int numWritten = 0;
+        
+        for( int i = 0; i < numSamples; ++i )
+        {
+            auto sample = input[i];
+            
+            for( auto& section : lowpass )
+                sample = section.processSample(sample);
+            
+            if( phase == 0 )
+                output[numWritten++] = sample;
+            
+            phase = (phase + 1) % factor;
+        }
+        
+        return numWritten;
+    }
+    
+    int getFactor() const { return factor; }
+private:
+    /** Decimates by 2 with a linear-phase FIR, skipping its zero taps. */
+    struct HalfbandStage
+    {
+        void prepare(const juce::Array<float>& coefficients)
+        {
+            taps.clear();
+            tapOffsets.clear();
+            
+            float largest = 0.f;
+            for( auto c : coefficients )
+                largest = juce::jmax(largest, std::abs(c));
+            
+            // every other tap of a halfband is zero apart from rounding
+            for( int i = 0; i < coefficients.size(); ++i )
+            {
+                if( std::abs(coefficients[i]) > largest * 1.0e-6f )
+                {
+                    taps.push_back(coefficients[i]);
+                    tapOffsets.push_back(i);
+                }
+            }
+            
+            length = coefficients.size();
+            history.assign(2 * (size_t)length, 0.f);
+            writeIndex = 0;
+            phase = 0;
+        }
+        
+        int process(const float* input, int numSamples, float* output)
+        {
+            int numWritten = 0;
+            
+            for( int i = 0; i < numSamples; ++i )
+            {
+                // written twice, so the latest length samples are always contiguous
+                history[(size_t)writeIndex] = history[(size_t)(writeIndex + length)] = input[i];
+                writeIndex = (writeIndex + 1) % length;
+                
+                if( phase == 0 )
+                {
+                    const auto* window = history.data() + writeIndex;
+                    float sum = 0.f;
+                    
+                    for( size_t t = 0; t < taps.size(); ++t )
+                        sum += taps[t] * window[tapOffsets[t]];
+                    
+                    output[numWritten++] = sum;
+                }
+                
+                phase ^= 1;
+            }
+            
+            return numWritten;
+        }
+        
+        std::vector<float> taps;
+        std::vector<int> tapOffsets;
+        std::vector<float> history;
+        int length = 1, writeIndex = 0, phase = 0;
+    };
+    
+    std::vector<HalfbandStage> halfbands;
+    std::array<juce::dsp::IIR::Filter<float>, 4> lowpass;
+    int factor = 1;
+    int phase = 0;
+};
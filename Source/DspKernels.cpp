@@ -0,0 +1,301 @@
+//
+//  DspKernels.cpp
+//  SimpleEQ
+//
+
+// Only the AVX-512 (and any FMA) build could fuse a * b + c, which would round differently from the
+// others. With contraction off every level performs the same IEEE operations in the same order.
+// This comes before the includes, so the FastMath helpers inlined into the kernels are covered
+// too; JUCE's compiler macros aren't defined yet, hence the raw ones.
+#if defined (__clang__)
+ #pragma clang fp contract(off)
+#elif defined (__GNUC__)
+ #pragma GCC optimize ("fp-contract=off")
+#endif
+
+#include <JuceHeader.h>
+#include "DspKernels.h"
+#include "FastMath.h"
+
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define SIMPLEEQ_DISPATCH_X86 1
+#else
+ #define SIMPLEEQ_DISPATCH_X86 0
+#endif
+
+namespace DspKernels
+{
+namespace
+{
+    // The kernel bodies are forced inline into each per-level wrapper below, so they are
+    // vectorised for that wrapper's instruction set.
+    
+    forcedinline void processBiquadBankImpl(const BiquadBank& bank, float* left, float* right, int numSamples)
+    {
+        // bands outer, samples inner: each band's coefficients and state stay in registers for the
+        // whole block, and both channels run through the same loop body as independent lanes
+        for( int a = 0; a < bank.numActiveBands; ++a )
+        {
+            const auto k = bank.activeBands[a];
+            const auto cb0 = bank.b0[k], cb1 = bank.b1[k], cb2 = bank.b2[k], ca1 = bank.a1[k], ca2 = bank.a2[k];
+            
+            auto l1 = bank.z1[0][k], l2 = bank.z2[0][k];
+            
+            if( right != nullptr )
+            {
+                auto r1 = bank.z1[1][k], r2 = bank.z2[1][k];
+                
+                for( int n = 0; n < numSamples; ++n )
+                {
+                    const auto xl = left[n];
+                    const auto xr = right[n];
+                    
+                    const auto yl = cb0 * xl + l1;
+                    const auto yr = cb0 * xr + r1;
+                    
+                    l1 = cb1 * xl - ca1 * yl + l2;
+                    r1 = cb1 * xr - ca1 * yr + r2;
+                    
+                    l2 = cb2 * xl - ca2 * yl;
+                    r2 = cb2 * xr - ca2 * yr;
+                    
+                    left[n] = yl;
+                    right[n] = yr;
+                }
+                
+                bank.z1[1][k] = r1;
+                bank.z2[1][k] = r2;
+            }
+            else
+            {
+                for( int n = 0; n < numSamples; ++n )
+                {
+                    const auto x = left[n];
+                    const auto y = cb0 * x + l1;
+                    
+                    l1 = cb1 * x - ca1 * y + l2;
+                    l2 = cb2 * x - ca2 * y;
+                    
+                    left[n] = y;
+                }
+            }
+            
+            bank.z1[0][k] = l1;
+            bank.z2[0][k] = l2;
+        }
+    }
+    
+    forcedinline void windowStereoImpl(const float* left, const float* right, const float* window, float* complexOut, int size)
+    {
+        for( int i = 0; i < size; ++i )
+        {
+            complexOut[2 * i] = left[i] * window[i];
+            complexOut[2 * i + 1] = right[i] * window[i];
+        }
+    }
+    
+    forcedinline void stereoSpectrumToDecibelsImpl(const float* z, int fftSize, float floorDb, float* leftDb, float* rightDb)
+    {
+        // X_L[k] = (Z[k] + Z*[N-k]) / 2,  X_R[k] = (Z[k] - Z*[N-k]) / 2j
+        // the magnitudes are never square-rooted: the 1/2 becomes -6.02 dB on the power.
+        constexpr float halfInDecibels = 6.0206f;
+        
+        const auto numBins = fftSize / 2;
+        const auto powerFloorDb = floorDb + halfInDecibels;
+        
+        // The mirrored bins run backwards through interleaved memory, which doesn't vectorise, so
+        // they are first gathered into the outputs. The main pass then only reads forwards.
+        for( int k = 0; k < numBins; ++k )
+        {
+            const auto mirror = (fftSize - k) & (fftSize - 1);
+            leftDb[k] = z[2 * mirror];
+            rightDb[k] = z[2 * mirror + 1];
+        }
+        
+        for( int k = 0; k < numBins; ++k )
+        {
+            const auto re = z[2 * k];
+            const auto im = z[2 * k + 1];
+            const auto mirrorRe = leftDb[k];
+            const auto mirrorIm = rightDb[k];
+            
+            const auto leftPower = (re + mirrorRe) * (re + mirrorRe) + (im - mirrorIm) * (im - mirrorIm);
+            const auto rightPower = (re - mirrorRe) * (re - mirrorRe) + (im + mirrorIm) * (im + mirrorIm);
+            
+            leftDb[k] = FastMath::powerToDecibels(leftPower, powerFloorDb) - halfInDecibels;
+            rightDb[k] = FastMath::powerToDecibels(rightPower, powerFloorDb) - halfInDecibels;
+        }
+    }
+    
+    forcedinline void accumulateSectionResponseImpl(const SectionResponse& s, const float* phi, float* log2Magnitudes, int numColumns)
+    {
+        const auto sn0 = s.n0, sn1 = s.n1, sn2 = s.n2;
+        const auto sd0 = s.d0, sd1 = s.d1, sd2 = s.d2;
+        
+        for( int i = 0; i < numColumns; ++i )
+        {
+            const auto num = sn0 + phi[i] * (sn1 + phi[i] * sn2);
+            const auto den = sd0 + phi[i] * (sd1 + phi[i] * sd2);
+            log2Magnitudes[i] += FastMath::log2(num) - FastMath::log2(den);
+        }
+    }
+}
+
+// One set of thin wrappers per instruction set, each compiled for its target.
+#define SIMPLEEQ_DEFINE_KERNELS(Name, targetAttribute)                                                          \
+    namespace Name                                                                                              \
+    {                                                                                                           \
+        targetAttribute void processBiquadBank(const BiquadBank& bank, float* left, float* right, int n)       \
+        { processBiquadBankImpl(bank, left, right, n); }                                                        \
+        targetAttribute void windowStereo(const float* l, const float* r, const float* w, float* out, int n)    \
+        { windowStereoImpl(l, r, w, out, n); }                                                                  \
+        targetAttribute void stereoSpectrumToDecibels(const float* z, int n, float floorDb, float* l, float* r) \
+        { stereoSpectrumToDecibelsImpl(z, n, floorDb, l, r); }                                                  \
+        targetAttribute void accumulateSectionResponse(const SectionResponse& s, const float* p, float* o, int n) \
+        { accumulateSectionResponseImpl(s, p, o, n); }                                                          \
+    }
+
+#define SIMPLEEQ_KERNEL_TABLE(Name, instructionSet) \
+    KernelTable { instructionSet, #Name, Name::processBiquadBank, Name::windowStereo, Name::stereoSpectrumToDecibels, Name::accumulateSectionResponse }
+
+SIMPLEEQ_DEFINE_KERNELS(Generic, )
+
+#if SIMPLEEQ_DISPATCH_X86
+SIMPLEEQ_DEFINE_KERNELS(AVX2, __attribute__((target("avx2"))))
+SIMPLEEQ_DEFINE_KERNELS(AVX512, __attribute__((target("avx512f"))))
+#endif
+
+namespace
+{
+    const KernelTable genericKernels = SIMPLEEQ_KERNEL_TABLE(Generic, Isa_Generic);
+   #if SIMPLEEQ_DISPATCH_X86
+    const KernelTable avx2Kernels = SIMPLEEQ_KERNEL_TABLE(AVX2, Isa_AVX2);
+    const KernelTable avx512Kernels = SIMPLEEQ_KERNEL_TABLE(AVX512, Isa_AVX512);
+   #endif
+}
+
+bool producesIdenticalOutput(const KernelTable& candidate)
+{
+    constexpr int size = 1024;
+    constexpr int numBands = 8;
+    
+    juce::Random random(0x5eed);
+    
+    auto makeSignal = [&random](int length, float scale, float offset)
+    {
+        std::vector<float> v((size_t)length);
+        for( auto& x : v )
+            x = offset + scale * (2.f * random.nextFloat() - 1.f);
+        return v;
+    };
+    
+    auto same = [](const std::vector<float>& a, const std::vector<float>& b)
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+    };
+    
+    // biquads: a stable low-pass at every band, so the state builds up over the block
+    std::vector<float> b0(numBands, 0.2f), b1(numBands, 0.4f), b2(numBands, 0.2f), a1(numBands, -0.3f), a2(numBands, 0.1f);
+    std::array<std::vector<float>, 2> z1, z2;
+    std::array<int, numBands> activeBands {};
+    
+    for( int i = 0; i < numBands; ++i )
+        activeBands[(size_t)i] = i;
+    
+    auto runBank = [&](const KernelTable& kernels, std::vector<float>& left, std::vector<float>& right)
+    {
+        for( int ch = 0; ch < 2; ++ch )
+        {
+            z1[(size_t)ch].assign(numBands, 0.f);
+            z2[(size_t)ch].assign(numBands, 0.f);
+        }
+        
+        BiquadBank bank { b0.data(), b1.data(), b2.data(), a1.data(), a2.data(),
+                          { z1[0].data(), z1[1].data() }, { z2[0].data(), z2[1].data() },
+                          activeBands.data(), numBands };
+        
+        kernels.processBiquadBank(bank, left.data(), right.data(), size);
+        kernels.processBiquadBank(bank, left.data(), nullptr, size);
+    };
+    
+    const auto left = makeSignal(size, 1.f, 0.f);
+    const auto right = makeSignal(size, 1.f, 0.f);
+    const auto window = makeSignal(size, 0.5f, 0.5f);
+    const auto spectrum = makeSignal(2 * size, 100.f, 0.f);
+    const auto phi = makeSignal(size, 0.5f, 0.5f);
+    const SectionResponse section { 1.1f, -0.5f, 0.2f, 0.9f, -0.4f, 0.15f };
+    
+    auto expectedLeft = left, expectedRight = right, actualLeft = left, actualRight = right;
+    runBank(genericKernels, expectedLeft, expectedRight);
+    runBank(candidate, actualLeft, actualRight);
+    
+    std::vector<float> expectedWindowed(2 * size), actualWindowed(2 * size);
+    genericKernels.windowStereo(left.data(), right.data(), window.data(), expectedWindowed.data(), size);
+    candidate.windowStereo(left.data(), right.data(), window.data(), actualWindowed.data(), size);
+    
+    std::vector<float> expectedDb(size), actualDb(size);
+    genericKernels.stereoSpectrumToDecibels(spectrum.data(), size, -48.f, expectedDb.data(), expectedDb.data() + size / 2);
+    candidate.stereoSpectrumToDecibels(spectrum.data(), size, -48.f, actualDb.data(), actualDb.data() + size / 2);
+    
+    std::vector<float> expectedResponse(size, 0.f), actualResponse(size, 0.f);
+    genericKernels.accumulateSectionResponse(section, phi.data(), expectedResponse.data(), size);
+    candidate.accumulateSectionResponse(section, phi.data(), actualResponse.data(), size);
+    
+    return same(expectedLeft, actualLeft)
+        && same(expectedRight, actualRight)
+        && same(expectedWindowed, actualWindowed)
+        && same(expectedDb, actualDb)
+        && same(expectedResponse, actualResponse);
+}
+
+namespace
+{
+    const KernelTable& selectKernels()
+    {
+        const KernelTable* selected = &genericKernels;
+        
+        for( auto instructionSet : { Isa_AVX2, Isa_AVX512 } )
+        {
+            auto* kernels = getKernels(instructionSet);
+            
+            if( kernels == nullptr )
+                continue;
+            
+            // A mismatch means a kernel picked up an operation the levels round differently. It
+            // is caught in every build, and a level that fails is simply never used.
+            if( !producesIdenticalOutput(*kernels) )
+            {
+                jassertfalse;
+                continue;
+            }
+            
+            selected = kernels;
+        }
+        
+        return *selected;
+    }
+}
+
+const KernelTable& getKernels()
+{
+    static const KernelTable& kernels = selectKernels();
+    return kernels;
+}
+
+const KernelTable* getKernels(InstructionSet instructionSet)
+{
+    switch( instructionSet )
+    {
+        case Isa_Generic:
+            return &genericKernels;
+       #if SIMPLEEQ_DISPATCH_X86
+        case Isa_AVX2:
+            return juce::SystemStats::hasAVX2() ? &avx2Kernels : nullptr;
+        case Isa_AVX512:
+            return juce::SystemStats::hasAVX512F() ? &avx512Kernels : nullptr;
+       #endif
+        default:
+            return nullptr;
+    }
+}
+}
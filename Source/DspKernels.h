@@ -0,0 +1,73 @@
+//
+//  DspKernels.h
+//  SimpleEQ
+//
+
+#pragma once
+
+/**
+ The hot inner loops, compiled once per instruction set and chosen at runtime.
+
+ Each kernel is written once as plain scalar code. On x86 with gcc or clang it is also built for
+ AVX2 and AVX-512, and getKernels() picks the widest set the CPU reports, so one binary uses the
+ vector units of whatever machine it runs on. Generic is the compiler's baseline: SSE2 on x86-64
+ and NEON on arm64.
+
+ Fused multiply-adds are disabled for these loops, because only some levels have them. That makes
+ every level bit-identical to Generic. getKernels() checks that before it picks a level, in every
+ build, and skips any level that doesn't match.
+ */
+namespace DspKernels
+{
+    enum InstructionSet
+    {
+        Isa_Generic,
+        Isa_AVX2,
+        Isa_AVX512
+    };
+    
+    /** A bank of transposed direct form II biquads in structure-of-arrays form, indexed by band. */
+    struct BiquadBank
+    {
+        const float *b0, *b1, *b2, *a1, *a2;
+        float *z1[2], *z2[2];
+        const int* activeBands;
+        int numActiveBands;
+    };
+    
+    /** |H|^2 = (n0 + n1 phi + n2 phi^2) / (d0 + d1 phi + d2 phi^2) */
+    struct SectionResponse
+    {
+        float n0, n1, n2, d0, d1, d2;
+    };
+    
+    struct KernelTable
+    {
+        InstructionSet instructionSet;
+        const char* name; // e.g. "AVX2", for logs and cache keys
+        
+        /** Runs the active bands in series over left, and right if it isn't null, in place. */
+        void (*processBiquadBank)(const BiquadBank& bank, float* left, float* right, int numSamples);
+        
+        /** Packs left * window into the real parts and right * window into the imaginary parts. */
+        void (*windowStereo)(const float* left, const float* right, const float* window, float* complexOut, int size);
+        
+        /**
+         Separates the spectrum of a stereo pair packed by windowStereo into the first fftSize / 2
+         bins of each channel, in dB, clamped to floorDb.
+         */
+        void (*stereoSpectrumToDecibels)(const float* spectrum, int fftSize, float floorDb, float* leftDb, float* rightDb);
+        
+        /** Adds log2 |H|^2 of a section at every column's phi = sin^2(w/2) to log2Magnitudes. */
+        void (*accumulateSectionResponse)(const SectionResponse& section, const float* phi, float* log2Magnitudes, int numColumns);
+    };
+    
+    /** The widest kernels this CPU supports and that match Generic, chosen on first use. */
+    const KernelTable& getKernels();
+    
+    /** Returns null if the CPU, or this build, doesn't support the set. */
+    const KernelTable* getKernels(InstructionSet instructionSet);
+    
+    /** Runs every kernel of candidate and Generic on the same pseudo-random data and compares the bits. */
+    bool producesIdenticalOutput(const KernelTable& candidate);
+}
@@ -0,0 +1,206 @@
+//
+//  DynamicBands.cpp
+//  SimpleEQ
+//
+
+#include "DynamicBands.h"
+#include "FastMath.h"
+#include "CoefficientDesign.h"
+
+juce::String getDynamicBandParameterID(int bandIndex, const juce::String& name)
+{
+    return "Dyn" + juce::String(bandIndex + 1) + " " + name;
+}
+
+void DynamicBandParameters::attachTo(juce::AudioProcessorValueTreeState& apvts, int bandIndex)
+{
+    freq = apvts.getRawParameterValue(getDynamicBandParameterID(bandIndex, "Freq"));
+    quality = apvts.getRawParameterValue(getDynamicBandParameterID(bandIndex, "Quality"));
+    threshold = apvts.getRawParameterValue(getDynamicBandParameterID(bandIndex, "Threshold"));
+    ratio = apvts.getRawParameterValue(getDynamicBandParameterID(bandIndex, "Ratio"));
+    range = apvts.getRawParameterValue(getDynamicBandParameterID(bandIndex, "Range"));
+    attack = apvts.getRawParameterValue(getDynamicBandParameterID(bandIndex, "Attack"));
+    release = apvts.getRawParameterValue(getDynamicBandParameterID(bandIndex, "Release"));
+    useSidechain = apvts.getRawParameterValue(getDynamicBandParameterID(bandIndex, "Sidechain"));
+    bypassed = apvts.getRawParameterValue(getDynamicBandParameterID(bandIndex, "Bypassed"));
+}
+
+DynamicBandSettings DynamicBandParameters::load() const
+{
+    DynamicBandSettings settings;
+    
+    settings.freq = freq->load();
+    settings.quality = quality->load();
+    settings.thresholdInDecibels = threshold->load();
+    settings.ratio = ratio->load();
+    settings.rangeInDecibels = range->load();
+    settings.attackMs = attack->load();
+    settings.releaseMs = release->load();
+    settings.useSidechain = useSidechain->load() > 0.5f;
+    settings.bypassed = bypassed->load() > 0.5f;
+    
+    return settings;
+}
+
+//==============================================================================
+void DynamicBands::Svf::setup(double sampleRate, float freq, float quality)
+{
+    const auto g = prewarpFrequency(freq, sampleRate);
+    
+    k = 1.f / quality;
+    a1 = 1.f / (1.f + g * (g + k));
+    a2 = g * a1;
+    a3 = g * a2;
+}
+
+void DynamicBands::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    
+    for( auto& band : bands )
+        updateCoefficients(band);
+    
+    reset();
+}
+
+void DynamicBands::reset()
+{
+    for( int i = 0; i < numBands; ++i )
+    {
+        auto& band = bands[i];
+        
+        band.filterState.fill({});
+        band.detectorState.fill({});
+        band.envelope = 0.f;
+        band.gainMinusOne = 0.f;
+    }
+}
+
+void DynamicBands::setBand(int bandIndex, const DynamicBandSettings& newSettings)
+{
+    jassert(juce::isPositiveAndBelow(bandIndex, numBands));
+    
+    auto& band = bands[bandIndex];
+    auto& current = band.settings;
+    
+    const auto needsCoefficients = newSettings.freq != current.freq
+                                || newSettings.quality != current.quality
+                                || newSettings.attackMs != current.attackMs
+                                || newSettings.releaseMs != current.releaseMs;
+    
+    if( current.bypassed && !newSettings.bypassed )
+    {
+        band.filterState.fill({});
+        band.detectorState.fill({});
+        band.envelope = 0.f;
+        band.gainMinusOne = 0.f;
+    }
+    
+    current = newSettings;
+    
+    if( needsCoefficients )
+        updateCoefficients(band);
+}
+
+void DynamicBands::updateCoefficients(Band& band)
+{
+    if( sampleRate <= 0.0 )
+        return;
+    
+    const auto& settings = band.settings;
+    
+    band.svf.setup(sampleRate,
+                   juce::jlimit(10.f, float(sampleRate * 0.49), settings.freq),
+                   juce::jmax(0.025f, settings.quality));
+    
+    auto envelopeCoefficient = [this](float milliseconds)
+    {
+        const auto samples = juce::jmax(1.0, milliseconds * 0.001 * sampleRate);
+        return float(1.0 - std::exp(-1.0 / samples));
+    };
+    
+    band.attackCoefficient = envelopeCoefficient(settings.attackMs);
+    band.releaseCoefficient = envelopeCoefficient(settings.releaseMs);
+}
+
+float DynamicBands::computeGainMinusOne(const Band& band) const
+{
+    constexpr float decibelsPerOctave = 6.02059991f; // 20 * log10(2)
+    
+    const auto& settings = band.settings;
+    const auto envelopeDb = FastMath::log2(band.envelope + 1.0e-9f) * decibelsPerOctave;
+    const auto over = envelopeDb - settings.thresholdInDecibels;
+    
+    if( over <= 0.f )
+        return 0.f;
+    
+    const auto gainDb = juce::jmax(settings.rangeInDecibels, -over * (1.f - 1.f / settings.ratio));
+    return juce::Decibels::decibelsToGain(gainDb) - 1.f;
+}
+
+void DynamicBands::process(juce::AudioBuffer<float>& main, const juce::AudioBuffer<float>* sidechain)
+{
+    const auto numChannels = juce::jmin(main.getNumChannels(), maxChannels);
+    const auto numSamples = main.getNumSamples();
+    
+    if( numChannels == 0 )
+        return;
+    
+    const auto hasSidechain = sidechain != nullptr && sidechain->getNumChannels() > 0;
+    
+    for( int b = 0; b < numBands; ++b )
+    {
+        auto& band = bands[b];
+        const auto& settings = band.settings;
+        
+        if( settings.bypassed )
+            continue;
+        
+        const auto keyFromSidechain = settings.useSidechain && hasSidechain;
+        
+        std::array<float*, maxChannels> channels {};
+        std::array<const float*, maxChannels> keyChannels {};
+        
+        for( int ch = 0; ch < numChannels; ++ch )
+        {
+            channels[ch] = main.getWritePointer(ch);
+            
+            if( keyFromSidechain )
+                keyChannels[ch] = sidechain->getReadPointer(juce::jmin(ch, sidechain->getNumChannels() - 1));
+        }
+        
+        for( int start = 0; start < numSamples; start += subBlockSize )
+        {
+            const auto length = juce::jmin(subBlockSize, numSamples - start);
+            
+            // the gain computer (a log and an exp) runs once per sub-block, the ramp is an add per sample
+            const auto target = computeGainMinusOne(band);
+            const auto step = (target - band.gainMinusOne) / float(length);
+            
+            for( int n = start; n < start + length; ++n )
+            {
+                band.gainMinusOne += step;
+                
+                auto keyLevel = 0.f;
+                
+                for( int ch = 0; ch < numChannels; ++ch )
+                {
+                    const auto x = channels[ch][n];
+                    const auto bandPass = band.filterState[ch].processBandPass(band.svf, x);
+                    
+                    // keyed from main, the detector would run the same filter on the same input
+                    const auto key = keyFromSidechain ? band.detectorState[ch].processBandPass(band.svf, keyChannels[ch][n])
+                                                      : bandPass;
+                    keyLevel = juce::jmax(keyLevel, std::abs(key));
+                    
+                    channels[ch][n] = x + band.gainMinusOne * bandPass;
+                }
+                
+                const auto coefficient = keyLevel > band.envelope ? band.attackCoefficient : band.releaseCoefficient;
+                band.envelope += coefficient * (keyLevel - band.envelope);
+            }
+            
+            band.gainMinusOne = target;
+        }
+    }
+}
@@ -0,0 +1,107 @@
+//
+//  DynamicBands.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+struct DynamicBandSettings
+{
+    float freq { 6000.f }, quality { 2.f };
+    float thresholdInDecibels { -24.f }, ratio { 4.f }, rangeInDecibels { -12.f };
+    float attackMs { 1.f }, releaseMs { 60.f };
+    bool useSidechain { false };
+    bool bypassed { true };
+};
+
+/** "Dyn<n> <name>", with bands numbered from 1. */
+juce::String getDynamicBandParameterID(int bandIndex, const juce::String& name);
+
+/** Caches one dynamic band's raw parameter pointers. */
+struct DynamicBandParameters
+{
+    void attachTo(juce::AudioProcessorValueTreeState& apvts, int bandIndex);
+    DynamicBandSettings load() const;
+private:
+    std::atomic<float>* freq = nullptr;
+    std::atomic<float>* quality = nullptr;
+    std::atomic<float>* threshold = nullptr;
+    std::atomic<float>* ratio = nullptr;
+    std::atomic<float>* range = nullptr;
+    std::atomic<float>* attack = nullptr;
+    std::atomic<float>* release = nullptr;
+    std::atomic<float>* useSidechain = nullptr;
+    std::atomic<float>* bypassed = nullptr;
+};
+
+/**
+ Bell bands whose cut follows the level in their own band, of either the input or the sidechain.
+
+ Each band is a TPT state-variable filter: y = x + m * bp, where bp is its unity-gain band-pass
+ output and m = gain - 1. The SVF's tuning only depends on frequency and Q, so modulating the gain
+ just changes m and never disturbs the filter state. A matching SVF band-passes the key signal into
+ a peak envelope follower. The gain computer runs once per subBlockSize samples and m is ramped
+ linearly in between.
+ */
+struct DynamicBands
+{
+    static constexpr int numBands = 4;
+    static constexpr int maxChannels = 2;
+    static constexpr int subBlockSize = 16;
+    
+    void prepare(double sampleRate);
+    void reset();
+    
+    void setBand(int bandIndex, const DynamicBandSettings& newSettings);
+    
+    /**
+     Processes up to two channels of main in place. sidechain may be null or empty, in which case
+     bands set to use it are keyed from main instead.
+     */
+    void process(juce::AudioBuffer<float>& main, const juce::AudioBuffer<float>* sidechain);
+private:
+    struct Svf
+    {
+        float a1 = 0.f, a2 = 0.f, a3 = 0.f, k = 1.f;
+        
+        void setup(double sampleRate, float freq, float quality);
+    };
+    
+    struct SvfState
+    {
+        float ic1 = 0.f, ic2 = 0.f;
+        
+        /** Returns the unity-gain band-pass output. */
+        float processBandPass(const Svf& svf, float x)
+        {
+            const auto v3 = x - ic2;
+            const auto v1 = svf.a1 * ic1 + svf.a2 * v3;
+            const auto v2 = ic2 + svf.a2 * ic1 + svf.a3 * v3;
+            
+            ic1 = 2.f * v1 - ic1;
+            ic2 = 2.f * v2 - ic2;
+            
+            return svf.k * v1;
+        }
+    };
+    
+    struct Band
+    {
+        DynamicBandSettings settings;
+        Svf svf;
+        float attackCoefficient = 0.f, releaseCoefficient = 0.f;
+        
+        std::array<SvfState, maxChannels> filterState, detectorState;
+        float envelope = 0.f;
+        float gainMinusOne = 0.f;
+    };
+    
+    double sampleRate = 44100.0;
+    std::array<Band, numBands> bands;
+    
+    void updateCoefficients(Band& band);
+    float computeGainMinusOne(const Band& band) const;
+};
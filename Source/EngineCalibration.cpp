@@ -0,0 +1,76 @@
+//
+//  EngineCalibration.cpp
+//  SimpleEQ
+//
+
+#include "EngineCalibration.h"
+#include "DspKernels.h"
+
+namespace
+{
+    constexpr int calibrationVersion = 1;
+}
+
+EngineCalibration::EngineCalibration()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+    
+    const auto persisted = openFile()->getAllProperties();
+    
+    for( const auto& key : persisted.getAllKeys() )
+        results[key] = persisted[key];
+}
+
+EngineCalibration::~EngineCalibration()
+{
+    // the pool drops jobs that haven't started, so give queued results a moment to reach the file
+    for( int i = 0; i < 100 && writer.getNumJobs() > 0; ++i )
+        juce::Thread::sleep(10);
+}
+
+/** Opened only when needed: once when the cache is created, and once per new configuration to save. */
+std::unique_ptr<juce::PropertiesFile> EngineCalibration::openFile()
+{
+    juce::PropertiesFile::Options options;
+    options.applicationName = "SimpleEQ";
+    options.folderName = "SimpleEQ";
+    options.filenameSuffix = "calibration";
+    options.osxLibrarySubFolder = "Application Support";
+    options.millisecondsBeforeSaving = 0; // save on every change instead of on a timer
+    
+    return std::make_unique<juce::PropertiesFile>(options);
+}
+
+juce::String EngineCalibration::makeKey(double sampleRate, int blockSize, int numChannels)
+{
+    juce::String key;
+    
+    key << "v" << calibrationVersion
+        << "|" << juce::SystemStats::getCpuModel()
+        << "|" << DspKernels::getKernels().name
+        << "|" << juce::roundToInt(sampleRate)
+        << "|" << blockSize
+        << "|" << numChannels;
+    
+    return key;
+}
+
+juce::String EngineCalibration::find(const juce::String& key)
+{
+    const juce::ScopedLock sl(lock);
+    
+    auto it = results.find(key);
+    return it != results.end() ? it->second : juce::String();
+}
+
+void EngineCalibration::store(const juce::String& key, const juce::String& result)
+{
+    const juce::ScopedLock sl(lock);
+    
+    results[key] = result;
+    
+    writer.addJob([key, result]
+    {
+        openFile()->setValue(key, result);
+    });
+}
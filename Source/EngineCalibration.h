@@ -0,0 +1,49 @@
+//
+//  EngineCalibration.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+/**
+ Remembers the outcome of timing the filter engines against each other, per machine and
+ configuration.
+
+ Results are shared by every instance in the process and persisted to a properties file in the
+ user's application data, so each configuration is only timed once per machine. What a result
+ holds is up to the caller; the cache just maps a key to a string.
+
+ Access it through juce::SharedResourcePointer<EngineCalibration>, like SharedResourcePool, so
+ it and its writer thread go away with the last instance rather than at static destruction.
+ The first pointer, created on the message thread, reads the file; after that only the
+ background writer touches it, so find() and store() are safe to call from prepareToPlay.
+ */
+struct EngineCalibration
+{
+    EngineCalibration();
+    ~EngineCalibration();
+    
+    /**
+     Identifies the CPU, the instruction set the DSP kernels run with and the processing
+     configuration. calibrationVersion is part of it, so bump that whenever an engine is added or
+     changes enough to need timing again.
+     */
+    static juce::String makeKey(double sampleRate, int blockSize, int numChannels);
+    
+    /** Returns an empty string if the key hasn't been calibrated on this machine yet. */
+    juce::String find(const juce::String& key);
+    
+    /** Takes effect at once in this process; the file is written on a background thread. */
+    void store(const juce::String& key, const juce::String& result);
+private:
+    juce::CriticalSection lock;
+    std::map<juce::String, juce::String> results;
+    
+    /** One thread, so writes reach the file in the order they were stored. */
+    juce::ThreadPool writer { 1 };
+    
+    static std::unique_ptr<juce::PropertiesFile> openFile();
+};
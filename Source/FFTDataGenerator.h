@@ -0,0 +1,110 @@
+//
+//  FFTDataGenerator.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "SharedResourcePool.h"
+#include "DspKernels.h"
+
+enum FFTOrder {
+    order2048 = 11,
+    order4096 = 12,
+    order8192 = 13
+};
+
+/** Shifts a single-channel analysis history left and appends size new samples at its end. */
+inline void appendToAnalysisHistory(juce::AudioBuffer<float>& history, const float* incoming, int size)
+{
+    const auto historySize = history.getNumSamples();
+    
+    if( size >= historySize )
+    {
+        juce::FloatVectorOperations::copy(history.getWritePointer(0), incoming + size - historySize, historySize);
+        return;
+    }
+    
+    juce::FloatVectorOperations::copy(history.getWritePointer(0, 0),
+                                      history.getReadPointer(0, size),
+                                      historySize - size);
+    
+    juce::FloatVectorOperations::copy(history.getWritePointer(0, historySize - size),
+                                      incoming,
+                                      size);
+}
+
+template<typename BlockType>
+struct FFTDataGenerator
+{
+    /**
+     Both channels are analysed with a single complex FFT: the left channel is packed into the
+     real part and the right channel into the imaginary part, and the two spectra are separated
+     afterwards using conjugate symmetry.
+     The pushed block holds the left channel's bins followed by the right channel's bins.
+     */
+    void produceFFTDataForRendering(const juce::AudioBuffer<float>& leftData,
+                                    const juce::AudioBuffer<float>& rightData,
+                                    const float negativeInfinity)
+    {
+        const auto fftSize = getFFTSize();
+        const auto numBins = fftSize / 2;
+        
+        auto* left = leftData.getReadPointer(0);
+        auto* right = rightData.getReadPointer(0);
+        const auto* window = windowTable->data();
+        
+        // std::complex<float> is laid out as a pair of floats
+        kernels->windowStereo(left, right, window, reinterpret_cast<float*>(timeData.data()), fftSize);
+        
+        forwardFFT->perform(timeData.data(), frequencyData.data(), false);
+        
+        // separation, magnitude and dB conversion happen in place in fftData
+        kernels->stereoSpectrumToDecibels(reinterpret_cast<const float*>(frequencyData.data()),
+                                          fftSize,
+                                          negativeInfinity,
+                                          fftData.data(),
+                                          fftData.data() + numBins);
+        
+        fftDataFifo.push(fftData);
+    }
+    
+    void changeOrder(FFTOrder newOrder)
+    {
+        // when you change order, recreate the window, forwardFFT, fifo, fftData
+        // also reset the fifoIndex
+        // the FFT plan and window table are read-only, so they come from the process-wide pool
+        
+        order = newOrder;
+        auto fftSize = getFFTSize();
+        
+        forwardFFT = sharedResources->getFFT(order);
+        windowTable = sharedResources->getWindowTable(fftSize);
+        
+        timeData.assign(fftSize, {});
+        frequencyData.assign(fftSize, {});
+        
+        fftData.clear();
+        fftData.resize(fftSize, 0);
+        
+        fftDataFifo.prepare(fftData.size());
+    }
+    
+    //==============================================================================
+    int getFFTSize() const { return 1 << order; }
+    int getNumBins() const { return getFFTSize() / 2; }
+    int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading(); }
+    //==============================================================================
+    bool getFFTData(BlockType& fftData) { return fftDataFifo.pull(fftData); }
+private:
+    FFTOrder order;
+    BlockType fftData;
+    juce::SharedResourcePointer<SharedResourcePool> sharedResources;
+    std::shared_ptr<const juce::dsp::FFT> forwardFFT;
+    std::shared_ptr<const std::vector<float>> windowTable;
+    std::vector<juce::dsp::Complex<float>> timeData, frequencyData;
+    const DspKernels::KernelTable* kernels = &DspKernels::getKernels();
+    Fifo<BlockType> fftDataFifo;
+};
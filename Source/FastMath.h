@@ -0,0 +1,81 @@
+//
+//  FastMath.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ Branch-free approximations for the hot loops.
+ They are written so the compiler can vectorise any loop they are inlined into.
+ */
+namespace FastMath
+{
+    /** log2(x) for x > 0, max abs error ~1e-4 (~3e-4 dB). Zero and denormals map to about -127. */
+    inline float log2(float x) noexcept
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+
+        const auto exponent = float(int((bits >> 23) & 0xffu) - 127);
+
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+
+        // least-squares fit of log2(m) on [1, 2)
+        const auto p = -2.50561463f + (4.0496168f + (-2.09940219f + (0.635511076f - 0.0800108701f * m) * m) * m) * m;
+
+        return exponent + p;
+    }
+
+    /** sin(x) for |x| <= pi/2, max abs error ~2e-7. An odd degree 9 least-squares fit. */
+    inline float sinInHalfPi(float x) noexcept
+    {
+        const auto y = x * x;
+        return x * (0.999999998f + y * (-0.166666597f + y * (0.00833307984f + y * (-0.000198107508f + y * 2.60839208e-06f))));
+    }
+
+    /** sin(x), max abs error ~2e-7 for |x| <= pi. The float range reduction costs accuracy further out (~5e-6 at 100). */
+    inline float sin(float x) noexcept
+    {
+        constexpr float pi = 3.14159265f;
+        constexpr float twoPi = 6.28318531f;
+        constexpr float inverseTwoPi = 0.159154943f;
+
+        // wrap to [-pi, pi], then fold onto [-pi/2, pi/2] using sin(pi - x) == sin(x)
+        const auto turns = x * inverseTwoPi;
+        auto r = x - twoPi * float(int(turns + (turns < 0.f ? -0.5f : 0.5f)));
+
+        r = r > 0.5f * pi ? pi - r : r;
+        r = r < -0.5f * pi ? -pi - r : r;
+
+        return sinInHalfPi(r);
+    }
+
+    inline float cos(float x) noexcept
+    {
+        return FastMath::sin(x + 1.57079633f);
+    }
+
+    /**
+     tan(x) for |x| < pi/2, relative error ~2e-6 up to 0.49 pi (the bilinear prewarp at 0.49 fs).
+     Both halves of the ratio come from the same polynomial, so no range reduction is needed.
+     */
+    inline float tan(float x) noexcept
+    {
+        const auto magnitude = x < 0.f ? -x : x;
+        return sinInHalfPi(x) / sinInHalfPi(1.57079633f - magnitude);
+    }
+
+    /** 10 * log10(power), clamped to floorDb. */
+    inline float powerToDecibels(float power, float floorDb) noexcept
+    {
+        constexpr float decibelsPerOctave = 3.01029996f; // 10 * log10(2)
+        const auto dB = FastMath::log2(power) * decibelsPerOctave;
+        return dB < floorDb ? floorDb : dB;
+    }
+}
@@ -0,0 +1,134 @@
+//
+//  FramePacer.cpp
+//  SimpleEQ
+//
+
+#include "FramePacer.h"
+
+FramePacer::FramePacer(juce::Component& componentToSyncWith, std::function<void()> frameCallback) :
+component(componentToSyncWith),
+onFrame(std::move(frameCallback))
+{
+}
+
+FramePacer::~FramePacer()
+{
+    stop();
+}
+
+void FramePacer::start()
+{
+    if( running )
+        return;
+    
+    running = true;
+    lastVBlankMs = 0.0;
+    vblanksSinceUpdate = 0;
+    seedIntervalsMeasured = 0;
+    consecutiveLongIntervals = 0;
+    
+   #if JUCE_MAJOR_VERSION >= 7
+    vblankAttachment = std::make_unique<juce::VBlankAttachment>(&component, [this] { onVBlank(); });
+   #else
+    startTimerHz(60);
+   #endif
+}
+
+void FramePacer::stop()
+{
+    running = false;
+    
+   #if JUCE_MAJOR_VERSION >= 7
+    vblankAttachment.reset();
+   #endif
+    stopTimer();
+}
+
+void FramePacer::onVBlank()
+{
+    const auto now = juce::Time::getMillisecondCounterHiRes();
+    
+    if( lastVBlankMs > 0.0 )
+        updatePeriodEstimate(now - lastVBlankMs);
+    
+    lastVBlankMs = now;
+    
+    if( ++vblanksSinceUpdate < frameDivisor )
+        return;
+    
+    vblanksSinceUpdate = 0;
+    
+    onFrame();
+    
+    const auto cost = juce::Time::getMillisecondCounterHiRes() - now + pendingPaintCostMs;
+    pendingPaintCostMs = 0.0;
+    
+    adaptRate(cost);
+}
+
+void FramePacer::updatePeriodEstimate(double intervalMs)
+{
+    intervalMs = juce::jmax(1.0, intervalMs);
+    
+    // the initial 60 Hz guess may be far off, so it is replaced outright by the first intervals;
+    // the shortest of them is used, as a busy message thread can only make intervals longer
+    if( seedIntervalsMeasured < numSeedIntervals )
+    {
+        vblankPeriodMs = seedIntervalsMeasured == 0 ? intervalMs : juce::jmin(vblankPeriodMs, intervalMs);
+        ++seedIntervalsMeasured;
+        return;
+    }
+    
+    if( intervalMs < vblankPeriodMs * 1.5 )
+    {
+        vblankPeriodMs += 0.05 * (intervalMs - vblankPeriodMs);
+        consecutiveLongIntervals = 0;
+        return;
+    }
+    
+    // an occasional long gap means the message thread was busy, not that the display slowed down,
+    // so it is kept out of the estimate and treated as an overrun instead
+    pendingPaintCostMs += intervalMs - vblankPeriodMs;
+    
+    shortestLongIntervalMs = consecutiveLongIntervals == 0 ? intervalMs : juce::jmin(shortestLongIntervalMs, intervalMs);
+    
+    // but if nothing but long gaps arrive, the display (or its vblank throttling) really is slower
+    if( ++consecutiveLongIntervals >= longIntervalsBeforeRetuning )
+    {
+        vblankPeriodMs = shortestLongIntervalMs;
+        consecutiveLongIntervals = 0;
+    }
+}
+
+void FramePacer::adaptRate(double costMs)
+{
+    frameCostMs += 0.2 * (costMs - frameCostMs);
+    
+    const auto budgetPerVBlank = budgetFraction * vblankPeriodMs;
+    
+    if( frameCostMs > budgetPerVBlank * frameDivisor )
+    {
+        consecutiveHeadroomFrames = 0;
+        
+        if( ++consecutiveOverruns >= overrunsBeforeSlowingDown && frameDivisor < maxFrameDivisor )
+        {
+            ++frameDivisor;
+            consecutiveOverruns = 0;
+        }
+    }
+    else if( frameDivisor > 1 && frameCostMs < 0.5 * budgetPerVBlank * (frameDivisor - 1) )
+    {
+        consecutiveOverruns = 0;
+        
+        if( ++consecutiveHeadroomFrames >= headroomFramesBeforeSpeedingUp )
+        {
+            --frameDivisor;
+            consecutiveHeadroomFrames = 0;
+        }
+    }
+    else
+    {
+        consecutiveOverruns = 0;
+        consecutiveHeadroomFrames = 0;
+    }
+}
@@ -0,0 +1,77 @@
+//
+//  FramePacer.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ Drives periodic GUI updates from the display's vblank when JUCE provides it, falling back to a
+ 60 Hz timer otherwise.
+ 
+ The cost of every update (the callback plus whatever paint time the owner reports) is measured
+ against a budget that is a fraction of the display's frame period. Updates are spread over more
+ vblanks when the budget is overrun, and brought back to every vblank when there is headroom, so a
+ heavy editor can't drag down the host's UI.
+ */
+struct FramePacer : private juce::Timer
+{
+    FramePacer(juce::Component& componentToSyncWith, std::function<void()> frameCallback);
+    ~FramePacer() override;
+    
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+    
+    /** Adds time spent painting on behalf of the last update; it counts towards the next budget check. */
+    void addPaintCost(double milliseconds) { pendingPaintCostMs += milliseconds; }
+    
+    /** The share of a display frame the updates may use, e.g. 0.25 for a quarter. */
+    void setBudgetFraction(double newFraction) { budgetFraction = juce::jlimit(0.01, 1.0, newFraction); }
+    
+    /** The number of vblanks between updates currently in use. */
+    int getFrameDivisor() const { return frameDivisor; }
+    double getUpdateRateHz() const { return 1000.0 / (vblankPeriodMs * frameDivisor); }
+private:
+    juce::Component& component;
+    std::function<void()> onFrame;
+    
+   #if JUCE_MAJOR_VERSION >= 7
+    std::unique_ptr<juce::VBlankAttachment> vblankAttachment;
+   #endif
+    
+    bool running = false;
+    
+    static constexpr int maxFrameDivisor = 8;
+    static constexpr int overrunsBeforeSlowingDown = 3;
+    static constexpr int headroomFramesBeforeSpeedingUp = 30;
+    static constexpr int numSeedIntervals = 4;
+    static constexpr int longIntervalsBeforeRetuning = 10;
+    
+    double budgetFraction = 0.25;
+    double vblankPeriodMs = 1000.0 / 60.0;
+    double lastVBlankMs = 0.0;
+    double frameCostMs = 0.0;
+    double pendingPaintCostMs = 0.0;
+    
+    int frameDivisor = 1;
+    int vblanksSinceUpdate = 0;
+    int consecutiveOverruns = 0;
+    int consecutiveHeadroomFrames = 0;
+    
+    /** The period starts out as the shortest of the first few intervals, whatever the display rate. */
+    int seedIntervalsMeasured = 0;
+    
+    /** A run of long intervals with no short one in between means the display itself got slower. */
+    int consecutiveLongIntervals = 0;
+    double shortestLongIntervalMs = 0.0;
+    
+    void timerCallback() override { onVBlank(); }
+    void onVBlank();
+    void updatePeriodEstimate(double intervalMs);
+    void adaptRate(double costMs);
+    
+    JUCE_DECLARE_NON_COPYABLE(FramePacer)
+};
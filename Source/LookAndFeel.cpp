@@ -24,46 +24,96 @@ void LookAndFeel::drawRotarySlider (juce::Graphics& g,
     
     auto enabled = slider.isEnabled();
     
-    g.setColour(enabled ? Colour(97u, 18u, 167u) : Colours::darkgrey);
-    g.fillEllipse(bounds);
+    auto* rswl = dynamic_cast<RotarySliderWithLabels*>(&slider);
     
-    g.setColour(enabled ? Colour(255u, 154u, 1u) : Colours::grey);
-    g.drawEllipse(bounds, 1.f);
-    
-    if( auto* rswl = dynamic_cast<RotarySliderWithLabels*>(&slider) )
+    if( rswl == nullptr || width != height )
     {
-        auto center = bounds.getCentre();
-        
-        Path p;
-        
-        Rectangle<float> r;
-        r.setLeft(center.getX() - 2);
-        r.setRight(center.getX() + 2);
-        r.setTop(bounds.getY());
-        r.setBottom(center.getY() - rswl->getTextHeight() * 1.5);
-        p.addRoundedRectangle(r, 2.f);
-        
-        jassert(rotaryStartAngle < rotaryEndAngle);
-        
-        auto sliderAngRad = jmap(sliderPosProportional, 0.f, 1.f, rotaryStartAngle, rotaryEndAngle);
-        
-        p.applyTransform(AffineTransform().rotated(sliderAngRad, center.getX(), center.getY()));
+        g.setColour(enabled ? Colour(97u, 18u, 167u) : Colours::darkgrey);
+        g.fillEllipse(bounds);
         
-        g.fillPath(p);
-        
-        g.setFont(rswl->getTextHeight());
-        auto text = rswl->getDisplayString();
-        auto strWidth = g.getCurrentFont().getStringWidth(text);
+        g.setColour(enabled ? Colour(255u, 154u, 1u) : Colours::grey);
+        g.drawEllipse(bounds, 1.f);
+        return;
+    }
+    
+    // blitting the pre-rendered body keeps knob repaints cheap while parameters are automated
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    const auto& sprites = getKnobSprites(width, rswl->getTextHeight(), scale);
+    
+    g.drawImage(sprites.body[enabled], bounds);
+    
+    jassert(rotaryStartAngle < rotaryEndAngle);
+    
+    auto center = bounds.getCentre();
+    auto sliderAngRad = jmap(sliderPosProportional, 0.f, 1.f, rotaryStartAngle, rotaryEndAngle);
+    
+    {
+        Graphics::ScopedSaveState state(g);
+        g.addTransform(AffineTransform::rotation(sliderAngRad, center.getX(), center.getY()));
+        
+        g.setColour(enabled ? Colour(255u, 154u, 1u) : Colours::grey);
+        g.fillRoundedRectangle(Rectangle<float>(center.getX() - sprites.indicatorWidth * 0.5f,
+                                                bounds.getY(),
+                                                sprites.indicatorWidth,
+                                                sprites.indicatorLength),
+                               2.f);
+    }
+    
+    const auto& valueText = rswl->getValueTextLayout();
+    
+    Rectangle<float> r;
+    r.setSize(valueText.width + 4, rswl->getTextHeight() + 2);
+    r.setCentre(bounds.getCentre());
+    
+    g.setColour(enabled ? Colours::black : Colours::darkgrey);
+    g.fillRect(r);
+    
+    g.setColour(enabled ? Colours::white : Colours::lightgrey);
+    valueText.glyphs.draw(g, AffineTransform::translation(r.getX(), r.getY()));
+}
+
+const LookAndFeel::KnobSprites& LookAndFeel::getKnobSprites(int diameter, int textHeight, float scale)
+{
+    using namespace juce;
+    
+    for( const auto& sprites : knobSprites )
+    {
+        if( sprites.diameter == diameter && sprites.textHeight == textHeight && sprites.scale == scale )
+            return sprites;
+    }
+    
+    if( knobSprites.size() >= maxCachedKnobSizes )
+        knobSprites.pop_front();
+    
+    auto& sprites = knobSprites.emplace_back();
+    sprites.diameter = diameter;
+    sprites.textHeight = textHeight;
+    sprites.scale = scale;
+    sprites.indicatorWidth = 4.f;
+    sprites.indicatorLength = jmax(1.f, diameter * 0.5f - textHeight * 1.5f);
+    
+    // layout: [disabled body][enabled body]
+    const auto bodySize = roundToInt(diameter * scale);
+    
+    sprites.atlas = Image(Image::PixelFormat::ARGB, 2 * bodySize, bodySize, true);
+    
+    Graphics g(sprites.atlas);
+    g.addTransform(AffineTransform::scale(scale));
+    
+    for( int enabled = 0; enabled < 2; ++enabled )
+    {
+        auto bounds = Rectangle<float>(enabled * diameter, 0, diameter, diameter);
         
-        r.setSize(strWidth + 4, rswl->getTextHeight() + 2);
-        r.setCentre(bounds.getCentre());
+        g.setColour(enabled ? Colour(97u, 18u, 167u) : Colours::darkgrey);
+        g.fillEllipse(bounds);
         
-        g.setColour(enabled ? Colours::black : Colours::darkgrey);
-        g.fillRect(r);
+        g.setColour(enabled ? Colour(255u, 154u, 1u) : Colours::grey);
+        g.drawEllipse(bounds, 1.f);
         
-        g.setColour(enabled ? Colours::white : Colours::lightgrey);
-        g.drawFittedText(text, r.toNearestInt(), juce::Justification::centred, 1);
+        sprites.body[enabled] = sprites.atlas.getClippedImage({ enabled * bodySize, 0, bodySize, bodySize });
     }
+    
+    return sprites;
 }
 
 void LookAndFeel::drawToggleButton (juce::Graphics& g,
@@ -115,4 +165,31 @@ void LookAndFeel::drawToggleButton (juce::Graphics& g,
         
         g.strokePath(analyzerButton->randomPath, PathStrokeType(1.f));
     }
+    else if( dynamic_cast<SpectrogramButton*>(&toggleButton) != nullptr )
+    {
+        auto color = !toggleButton.getToggleState() ? Colours::dimgrey : Colour(0u, 172u, 1u);
+        g.setColour(color);
+        
+        auto bounds = toggleButton.getLocalBounds();
+        g.drawRect(bounds);
+        
+        auto insetRect = bounds.reduced(4);
+        for( auto y = insetRect.getY(); y < insetRect.getBottom(); y += 3 )
+        {
+            auto alpha = jmap(float(y), float(insetRect.getY()), float(insetRect.getBottom()), 0.3f, 1.f);
+            g.setColour(color.withMultipliedAlpha(alpha));
+            g.drawHorizontalLine(y, insetRect.getX(), insetRect.getRight());
+        }
+    }
+    else if( dynamic_cast<CompareButton*>(&toggleButton) != nullptr )
+    {
+        // the label names the snapshot being heard, so it stays lit in either state
+        auto bounds = toggleButton.getLocalBounds();
+        
+        g.setColour(Colour(0u, 172u, 1u));
+        g.drawRect(bounds);
+        
+        g.setFont(bounds.getHeight() * 0.6f);
+        g.drawFittedText(toggleButton.getToggleState() ? "B" : "A", bounds, Justification::centred, 1);
+    }
 }
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <deque>
 
 struct LookAndFeel : juce::LookAndFeel_V4
 {
@@ -20,4 +21,25 @@ struct LookAndFeel : juce::LookAndFeel_V4
                            juce::ToggleButton& toggleButton,
                            bool shouldDrawButtonAsHighlighted,
                            bool shouldDrawButtonAsDown) override;
+private:
+    /**
+     Knob bodies, rendered once per diameter and display scale. The cells are sub-images of a
+     single atlas image. The indicator is a small rounded rectangle, which is cheaper to fill
+     rotated on every paint than to cache at every angle.
+     */
+    struct KnobSprites
+    {
+        int diameter = 0;
+        int textHeight = 0;
+        float scale = 1.f;
+        
+        juce::Image atlas;
+        juce::Image body[2]; // [disabled, enabled]
+        float indicatorWidth = 0.f, indicatorLength = 0.f;
+    };
+    
+    static constexpr size_t maxCachedKnobSizes = 8;
+    std::deque<KnobSprites> knobSprites;
+    
+    const KnobSprites& getKnobSprites(int diameter, int textHeight, float scale);
 };
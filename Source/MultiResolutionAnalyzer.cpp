@@ -0,0 +1,141 @@
+//
+//  MultiResolutionAnalyzer.cpp
+//  SimpleEQ
+//
+
+#include "MultiResolutionAnalyzer.h"
+
+void MultiResolutionAnalyzer::prepare(double sampleRate, float newNegativeInfinity)
+{
+    preparedSampleRate = sampleRate;
+    negativeInfinity = newNegativeInfinity;
+    
+    double bandSampleRate = sampleRate;
+    int valuesPerChannel = 0;
+    
+    for( int b = 0; b < numBands; ++b )
+    {
+        auto& band = bands[b];
+        
+        // band 0 is decimated down to the display range above 48k,
+        // every other band decimates the band above it
+        if( b == 0 )
+        {
+            band.leftDecimator.prepareForDisplayRange(bandSampleRate);
+            band.rightDecimator.prepareForDisplayRange(bandSampleRate);
+        }
+        else
+        {
+            band.leftDecimator.prepare(bandSampleRate, decimationPerBand);
+            band.rightDecimator.prepare(bandSampleRate, decimationPerBand);
+        }
+        
+        bandSampleRate /= band.leftDecimator.getFactor();
+        band.sampleRate = bandSampleRate;
+        
+        band.generator.changeOrder(FFTOrder::order2048);
+        const auto fftSize = band.generator.getFFTSize();
+        const auto numBins = band.generator.getNumBins();
+        
+        band.leftHistory.setSize(1, fftSize);
+        band.rightHistory.setSize(1, fftSize);
+        band.leftHistory.clear();
+        band.rightHistory.clear();
+        band.latestFrame.assign(fftSize, negativeInfinity);
+        
+        // the decimated bands update less often, but still overlap their windows heavily
+        band.hopSize = b == 0 ? fftSize / 4 : fftSize / 8;
+        band.samplesSinceLastFrame = 0;
+        
+        // each band covers the octaves between a quarter of its own Nyquist and a quarter of the
+        // Nyquist of the band above, which keeps it well clear of the decimation filter's roll-off
+        const auto binWidth = bandSampleRate / fftSize;
+        const auto lowEdge = bandSampleRate / (2.0 * 2.0 * decimationPerBand);
+        const auto highEdge = bandSampleRate / (2.0 * 2.0);
+        
+        band.firstBin = b == numBands - 1 ? 0 : juce::jmin(numBins, (int)std::ceil(lowEdge / binWidth));
+        band.lastBin = b == 0 ? numBins : juce::jmin(numBins, (int)std::ceil(highEdge / binWidth));
+        
+        valuesPerChannel += band.lastBin - band.firstBin;
+    }
+    
+    binFrequencies.clear();
+    binFrequencies.reserve(valuesPerChannel);
+    
+    // lowest band first so the frequencies ascend
+    for( int b = numBands - 1; b >= 0; --b )
+    {
+        const auto& band = bands[b];
+        const auto binWidth = band.sampleRate / band.generator.getFFTSize();
+        
+        for( int bin = band.firstBin; bin < band.lastBin; ++bin )
+            binFrequencies.push_back(float(bin * binWidth));
+    }
+    
+    stitchedFrame.assign(2 * binFrequencies.size(), negativeInfinity);
+}
+
+bool MultiResolutionAnalyzer::pushBlock(const float* left, const float* right, int numSamples)
+{
+    bool fullRateFrameReady = false;
+    
+    for( int b = 0; b < numBands; ++b )
+    {
+        auto& band = bands[b];
+        
+        // only grows when the host's block size does
+        if( (int)band.leftDecimated.size() < numSamples )
+        {
+            band.leftDecimated.resize(numSamples);
+            band.rightDecimated.resize(numSamples);
+        }
+        
+        const auto numDecimated = band.leftDecimator.process(left, numSamples, band.leftDecimated.data());
+        band.rightDecimator.process(right, numSamples, band.rightDecimated.data());
+        
+        appendToAnalysisHistory(band.leftHistory, band.leftDecimated.data(), numDecimated);
+        appendToAnalysisHistory(band.rightHistory, band.rightDecimated.data(), numDecimated);
+        
+        band.samplesSinceLastFrame += numDecimated;
+        
+        if( band.samplesSinceLastFrame >= band.hopSize )
+        {
+            band.samplesSinceLastFrame = 0;
+            band.generator.produceFFTDataForRendering(band.leftHistory, band.rightHistory, negativeInfinity);
+            
+            while( band.generator.getNumAvailableFFTDataBlocks() > 0 )
+                band.generator.getFFTData(band.latestFrame);
+            
+            fullRateFrameReady = fullRateFrameReady || b == 0;
+        }
+        
+        left = band.leftDecimated.data();
+        right = band.rightDecimated.data();
+        numSamples = numDecimated;
+    }
+    
+    if( fullRateFrameReady )
+        stitch();
+    
+    return fullRateFrameReady;
+}
+
+void MultiResolutionAnalyzer::stitch()
+{
+    const auto valuesPerChannel = getNumValuesPerChannel();
+    auto* leftOut = stitchedFrame.data();
+    auto* rightOut = stitchedFrame.data() + valuesPerChannel;
+    
+    for( int b = numBands - 1; b >= 0; --b )
+    {
+        const auto& band = bands[b];
+        const auto numBins = band.generator.getNumBins();
+        const auto count = band.lastBin - band.firstBin;
+        
+        std::copy_n(band.latestFrame.data() + band.firstBin, count, leftOut);
+        std::copy_n(band.latestFrame.data() + numBins + band.firstBin, count, rightOut);
+        
+        leftOut += count;
+        rightOut += count;
+    }
+}
@@ -0,0 +1,74 @@
+//
+//  MultiResolutionAnalyzer.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FFTDataGenerator.h"
+#include "Decimator.h"
+
+/**
+ A constant-Q style analyzer built from several FFTs of the same size.
+ 
+ Band 0 runs on the input signal, decimated only as far as the display range allows at high
+ sample rates, and every further band runs on a signal decimated by another factor of 4, so each
+ band has 4x the frequency resolution of the one above it. The frames are stitched into one frame
+ per channel in which each band only contributes the octaves it resolves best. At 48k the lowest
+ band resolves ~1.5 Hz, finer than order8192 at full rate, while the decimated bands only need a
+ new FFT every few blocks.
+ */
+struct MultiResolutionAnalyzer
+{
+    static constexpr int numBands = 3;
+    static constexpr int decimationPerBand = 4;
+    
+    void prepare(double sampleRate, float negativeInfinity);
+    
+    /** Forces the next caller to prepare() again, e.g. after the analyzer sat unused for a while. */
+    void reset() { preparedSampleRate = 0.0; }
+    
+    /** Feeds one block of each channel; returns true when a new stitched frame is ready. */
+    bool pushBlock(const float* left, const float* right, int numSamples);
+    
+    /** The stitched frame: the left channel's values followed by the right channel's. */
+    const std::vector<float>& getFrame() const { return stitchedFrame; }
+    
+    /** The frequency of each value in one channel's half of the stitched frame. */
+    const std::vector<float>& getBinFrequencies() const { return binFrequencies; }
+    int getNumValuesPerChannel() const { return (int)binFrequencies.size(); }
+    
+    /** The most recent frame of the top band, in the plain FFTDataGenerator layout. */
+    const std::vector<float>& getTopBandFrame() const { return bands[0].latestFrame; }
+    int getTopBandNumBins() const { return bands[0].generator.getNumBins(); }
+    float getTopBandBinWidth() const { return float(bands[0].sampleRate / bands[0].generator.getFFTSize()); }
+    
+    double getPreparedSampleRate() const { return preparedSampleRate; }
+    
+    /** The time between stitched frames. */
+    float getFrameIntervalSeconds() const { return bands[0].sampleRate > 0.0 ? float(bands[0].hopSize / bands[0].sampleRate) : 0.f; }
+private:
+    struct Band
+    {
+        Decimator leftDecimator, rightDecimator;
+        juce::AudioBuffer<float> leftHistory, rightHistory;
+        std::vector<float> leftDecimated, rightDecimated;
+        FFTDataGenerator<std::vector<float>> generator;
+        std::vector<float> latestFrame;
+        double sampleRate = 0.0;
+        int hopSize = 0;
+        int samplesSinceLastFrame = 0;
+        
+        /** The bins [firstBin, lastBin) this band contributes to the stitched frame. */
+        int firstBin = 0, lastBin = 0;
+    };
+    
+    std::array<Band, numBands> bands;
+    std::vector<float> stitchedFrame;
+    std::vector<float> binFrequencies;
+    double preparedSampleRate = 0.0;
+    float negativeInfinity = -48.f;
+    
+    void stitch();
+};
@@ -61,10 +61,37 @@ analyzerEnabledButtonAttachment(audioProcessor.apvts, "Analyzer Enabled", analyz
         addAndMakeVisible(comp);
     }
     
-    peakBypassButton.setLookAndFeel(&lnf);
-    lowCutBypassButton.setLookAndFeel(&lnf);
-    highCutBypassButton.setLookAndFeel(&lnf);
-    analyzerEnabledButton.setLookAndFeel(&lnf);
+    peakBypassButton.setLookAndFeel(&lnf.get());
+    lowCutBypassButton.setLookAndFeel(&lnf.get());
+    highCutBypassButton.setLookAndFeel(&lnf.get());
+    analyzerEnabledButton.setLookAndFeel(&lnf.get());
+    spectrogramButton.setLookAndFeel(&lnf.get());
+    compareButton.setLookAndFeel(&lnf.get());
+    
+    compareButton.setToggleState(audioProcessor.getCurrentSnapshot() == 1, juce::dontSendNotification);
+    
+    // item IDs are indices into these tables plus one, since a ComboBox reserves 0 for no selection
+    static constexpr float averagingTimesMs[] { 0.f, 50.f, 100.f, 250.f, 500.f, 1000.f };
+    
+    analyzerAveragingBox.addItemList({ "No Averaging", "Avg 50 ms", "Avg 100 ms", "Avg 250 ms", "Avg 500 ms", "Avg 1 s" }, 1);
+    analyzerAveragingBox.setSelectedId(3, juce::dontSendNotification);
+    analyzerAveragingBox.setLookAndFeel(&lnf.get());
+    
+    static constexpr SpectrumSmoother::PeakHoldMode peakHoldModes[]
+    {
+        SpectrumSmoother::PeakHoldMode::Off,
+        SpectrumSmoother::PeakHoldMode::HoldAndDecay,
+        SpectrumSmoother::PeakHoldMode::Infinite
+    };
+    
+    analyzerPeakHoldBox.addItemList({ "No Peaks", "Peak Hold", "Max Hold" }, 1);
+    analyzerPeakHoldBox.setSelectedId(1, juce::dontSendNotification);
+    analyzerPeakHoldBox.setLookAndFeel(&lnf.get());
+    
+    analyzerModeBox.addItemList({ "Single FFT", "Multi-Res" }, 1);
+    analyzerModeBox.setSelectedId(responseCurveComponent.getAnalysisMode() == PathProducer::AnalysisMode::SingleResolution ? 1 : 2,
+                                  juce::dontSendNotification);
+    analyzerModeBox.setLookAndFeel(&lnf.get());
     
     auto safePtr = juce::Component::SafePointer<SimpleEQAudioProcessorEditor>(this);
     peakBypassButton.onClick = [safePtr]()
@@ -107,6 +134,55 @@ analyzerEnabledButtonAttachment(audioProcessor.apvts, "Analyzer Enabled", analyz
         }
     };
     
+    spectrogramButton.onClick = [safePtr]()
+    {
+        if( auto* comp = safePtr.getComponent() )
+        {
+            auto showSpectrogram = comp->spectrogramButton.getToggleState();
+            comp->responseCurveComponent.setAnalyzerView(showSpectrogram ? ResponseCurveComponent::AnalyzerView::Spectrogram
+                                                                         : ResponseCurveComponent::AnalyzerView::Spectrum);
+        }
+    };
+    
+    compareButton.onClick = [safePtr]()
+    {
+        if( auto* comp = safePtr.getComponent() )
+        {
+            auto showB = comp->compareButton.getToggleState();
+            comp->audioProcessor.selectSnapshot(showB ? 1 : 0);
+        }
+    };
+    
+    analyzerAveragingBox.onChange = [safePtr]()
+    {
+        if( auto* comp = safePtr.getComponent() )
+        {
+            auto index = comp->analyzerAveragingBox.getSelectedItemIndex();
+            comp->responseCurveComponent.setAnalyzerAveragingTime(averagingTimesMs[juce::jmax(0, index)]);
+        }
+    };
+    
+    analyzerPeakHoldBox.onChange = [safePtr]()
+    {
+        if( auto* comp = safePtr.getComponent() )
+        {
+            auto index = comp->analyzerPeakHoldBox.getSelectedItemIndex();
+            comp->responseCurveComponent.setAnalyzerPeakHold(peakHoldModes[juce::jmax(0, index)], 1000.f, 12.f);
+        }
+    };
+    
+    analyzerModeBox.onChange = [safePtr]()
+    {
+        if( auto* comp = safePtr.getComponent() )
+        {
+            auto singleResolution = comp->analyzerModeBox.getSelectedId() == 1;
+            comp->responseCurveComponent.setAnalysisMode(singleResolution ? PathProducer::AnalysisMode::SingleResolution
+                                                                          : PathProducer::AnalysisMode::MultiResolution);
+        }
+    };
+    
+    responseCurveComponent.toggleAnalysisEnabled(analyzerEnabledButton.getToggleState());
+    
     setSize (600, 400);
 }
 
@@ -116,6 +192,11 @@ SimpleEQAudioProcessorEditor::~SimpleEQAudioProcessorEditor()
     lowCutBypassButton.setLookAndFeel(nullptr);
     highCutBypassButton.setLookAndFeel(nullptr);
     analyzerEnabledButton.setLookAndFeel(nullptr);
+    spectrogramButton.setLookAndFeel(nullptr);
+    compareButton.setLookAndFeel(nullptr);
+    analyzerAveragingBox.setLookAndFeel(nullptr);
+    analyzerPeakHoldBox.setLookAndFeel(nullptr);
+    analyzerModeBox.setLookAndFeel(nullptr);
 }
 
 //==============================================================================
@@ -140,6 +221,22 @@ void SimpleEQAudioProcessorEditor::resized()
     
     analyzerEnabledButton.setBounds(analyzerEnabledArea);
     
+    auto spectrogramArea = analyzerEnabledArea.withX(analyzerEnabledArea.getRight() + 5);
+    spectrogramButton.setBounds(spectrogramArea);
+    
+    auto averagingArea = spectrogramArea.withX(spectrogramArea.getRight() + 5);
+    analyzerAveragingBox.setBounds(averagingArea);
+    
+    auto peakHoldArea = averagingArea.withX(averagingArea.getRight() + 5);
+    analyzerPeakHoldBox.setBounds(peakHoldArea);
+    
+    auto modeArea = peakHoldArea.withX(peakHoldArea.getRight() + 5);
+    analyzerModeBox.setBounds(modeArea);
+    
+    auto compareArea = spectrogramArea.withWidth(spectrogramArea.getHeight());
+    compareArea.setX(getLocalBounds().getRight() - compareArea.getWidth() - 5);
+    compareButton.setBounds(compareArea);
+    
     bounds.removeFromTop(5);
     
     float hRatio = 25.f / 100.f;
@@ -182,6 +279,11 @@ std::vector<juce::Component*> SimpleEQAudioProcessorEditor::getComps()
         &lowCutBypassButton,
         &peakBypassButton,
         &highCutBypassButton,
-        &analyzerEnabledButton
+        &analyzerEnabledButton,
+        &spectrogramButton,
+        &compareButton,
+        &analyzerAveragingBox,
+        &analyzerPeakHoldBox,
+        &analyzerModeBox
     };
 }
@@ -54,6 +54,11 @@ private:
     
     PowerButton lowCutBypassButton, peakBypassButton, highCutBypassButton;
     AnalyzerButton analyzerEnabledButton;
+    SpectrogramButton spectrogramButton;
+    CompareButton compareButton;
+    
+    /** Analyzer display settings. They only affect this editor's display, so they aren't parameters. */
+    juce::ComboBox analyzerAveragingBox, analyzerPeakHoldBox, analyzerModeBox;
     
     using ButtonAttachment = APVTS::ButtonAttachment;
     ButtonAttachment lowCutBypassButtonAttachment,
@@ -63,7 +68,7 @@ private:
     
     std::vector<juce::Component*> getComps();
     
-    LookAndFeel lnf;
+    juce::SharedResourcePointer<LookAndFeel> lnf;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessorEditor)
 };
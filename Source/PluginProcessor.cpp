@@ -8,6 +8,8 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "BinaryState.h"
+#include "EngineCalibration.h"
 
 //==============================================================================
 SimpleEQAudioProcessor::SimpleEQAudioProcessor()
@@ -16,16 +18,82 @@ SimpleEQAudioProcessor::SimpleEQAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 #endif
 {
+    // Auto can be selected at any time, and is only calibrated once it is
+    startTimerHz(4);
+    
+    for (int i = 0; i < BandBank::maxBands; ++i)
+        bandParameters[i].attachTo(apvts, i);
+    
+    for (int i = 0; i < DynamicBands::numBands; ++i)
+        dynamicBandParameters[i].attachTo(apvts, i);
+    
+    // everything not listed stays at its default
+    struct FactoryProgram
+    {
+        juce::String name;
+        std::vector<std::pair<juce::String, float>> values;
+    };
+    
+    const std::vector<FactoryProgram> factoryPrograms
+    {
+        { "Default", {} },
+        { "Rumble Filter", { { "LowCut Freq", 30.f }, { "LowCut Slope", Slope_48 } } },
+        { "Mud Cut", { { "LowCut Freq", 40.f }, { "Peak Freq", 300.f }, { "Peak Gain", -3.f }, { "Peak Quality", 1.4f } } },
+        { "Presence", { { "LowCut Freq", 40.f }, { "Peak Freq", 3500.f }, { "Peak Gain", 2.5f }, { "Peak Quality", 0.7f } } },
+        { "Air", { { "Peak Freq", 12000.f }, { "Peak Gain", 3.f }, { "Peak Quality", 0.5f } } },
+        { "Telephone", { { "LowCut Freq", 300.f }, { "LowCut Slope", Slope_24 },
+                         { "HighCut Freq", 3400.f }, { "HighCut Slope", Slope_24 }, { "Peak Bypassed", 1.f } } },
+    };
+    
+    const auto& parameters = getParameters();
+    
+    for (const auto& factoryProgram : factoryPrograms)
+    {
+        Program program;
+        program.name = factoryProgram.name;
+        
+        for (auto* parameter : parameters)
+            program.values.push_back(parameter->getDefaultValue());
+        
+        for (const auto& [parameterID, value] : factoryProgram.values)
+        {
+            auto* parameter = apvts.getParameter(parameterID);
+            jassert(parameter != nullptr);
+            program.values[(size_t)parameter->getParameterIndex()] = parameter->convertTo0to1(value);
+        }
+        
+        program.design.settings = getChainSettings(apvts, program.values);
+        programs.push_back(std::move(program));
+    }
 }
 
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
 {
+    stopTimer();
+}
+
+bool SimpleEQAudioProcessor::isAutoEngineSelected() const
+{
+    return static_cast<FilterEngine>((int)apvts.getRawParameterValue("Filter Engine")->load()) == FilterEngine::Engine_Auto;
+}
+
+void SimpleEQAudioProcessor::timerCallback()
+{
+    if (enginesAreCalibrated.load() || getSampleRate() <= 0.0 || !isAutoEngineSelected())
+        return;
+    
+    // Auto was picked after prepareToPlay; the audio thread stays out while the table changes
+    suspendProcessing(true);
+    calibrateEngines(getSampleRate(), getBlockSize());
+    chainDesignPending = true;
+    suspendProcessing(false);
 }
 
 //==============================================================================
@@ -68,26 +136,95 @@ double SimpleEQAudioProcessor::getTailLengthSeconds() const
 
 int SimpleEQAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return (int)programs.size();
 }
 
 int SimpleEQAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
 void SimpleEQAudioProcessor::setCurrentProgram (int index)
 {
+    if (!juce::isPositiveAndBelow(index, (int)programs.size()))
+        return;
+    
+    currentProgram = index;
+    recallProgram(programs[(size_t)index]);
 }
 
 const juce::String SimpleEQAudioProcessor::getProgramName (int index)
 {
-    return {};
+    if (!juce::isPositiveAndBelow(index, (int)programs.size()))
+        return {};
+    
+    return programs[(size_t)index].name;
 }
 
 void SimpleEQAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    if (juce::isPositiveAndBelow(index, (int)programs.size()))
+        programs[(size_t)index].name = newName;
+}
+
+void SimpleEQAudioProcessor::selectSnapshot(int index)
+{
+    if (!juce::isPositiveAndBelow(index, numSnapshots) || index == currentSnapshot)
+        return;
+    
+    snapshots[(size_t)currentSnapshot] = captureProgram(currentSnapshot == 0 ? "A" : "B");
+    currentSnapshot = index;
+    
+    auto& snapshot = snapshots[(size_t)index];
+    
+    // nothing to compare against yet, so the new slot starts where the other one is
+    if (snapshot.isEmpty())
+    {
+        snapshot = snapshots[(size_t)(1 - index)];
+        return;
+    }
+    
+    recallProgram(snapshot);
+}
+
+Program SimpleEQAudioProcessor::captureProgram(const juce::String& name)
+{
+    Program program;
+    program.name = name;
+    
+    for (auto* parameter : getParameters())
+        program.values.push_back(parameter->getValue());
+    
+    program.design = makeChainDesign(getChainSettings(apvts), getSampleRate());
+    
+    return program;
+}
+
+void SimpleEQAudioProcessor::recallProgram(Program& program)
+{
+    // only the sample rate can make a stored design stale
+    if (program.design.sampleRate != getSampleRate())
+        program.design = makeChainDesign(program.design.settings, getSampleRate());
+    
+    // The audio thread ignores parameter changes until the finished design arrives, so it never
+    // ramps towards a half-recalled program. The design goes out after the parameters, so by the
+    // time it is picked up they already hold the program's values.
+    ++programChangesInFlight;
+    
+    const auto& parameters = getParameters();
+    jassert((int)program.values.size() == parameters.size());
+    
+    for (int i = 0; i < juce::jmin(parameters.size(), (int)program.values.size()); ++i)
+    {
+        auto* parameter = parameters[i];
+        const auto value = program.values[(size_t)i];
+        
+        if (parameter->getValue() != value)
+            parameter->setValueNotifyingHost(value);
+    }
+    
+    if (!programDesignFifo.push(program.design))
+        --programChangesInFlight; // full, so the new values are smoothed towards like any other change
 }
 
 //==============================================================================
@@ -101,8 +238,28 @@ void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     
     spec.sampleRate = sampleRate;
     
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    for (auto& chain : chainInstances)
+        chain.prepare(spec);
+    
+    // the timings only matter to Auto; the timer catches up if it gets selected later
+    enginesAreCalibrated = false;
+    
+    if (isAutoEngineSelected())
+        calibrateEngines(sampleRate, samplesPerBlock);
+    
+    activeChain = &chainInstances[0];
+    fadingChain = nullptr;
+    fadeSamplesRemaining = 0;
+    fadeBuffer.setSize(2, samplesPerBlock);
+    
+    // Stored programs keep their designs for the old sample rate. They belong to the message
+    // thread, which redesigns one when it is recalled, so they aren't touched here.
+    
+    bandBank.prepare(sampleRate);
+    dynamicBands.prepare(sampleRate);
+    
+    chainSmoother.prepare(sampleRate, getChainSettings(apvts));
+    internalSamplePosition = 0;
     
     updateFilters();
     
@@ -135,6 +292,16 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+    
+    // the sidechain is optional, but when the host enables it it has to be mono or stereo
+    if (layouts.inputBuses.size() > 1)
+    {
+        auto sidechain = layouts.getChannelSet(true, 1);
+        if (!sidechain.isDisabled()
+         && sidechain != juce::AudioChannelSet::mono()
+         && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
 
     return true;
@@ -157,21 +324,112 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    juce::dsp::AudioBlock<float> block(buffer);
+    auto mainBuffer = getBusBuffer(buffer, true, 0);
+    auto sidechainBuffer = getBusBuffer(buffer, true, 1);
     
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    // a restored state jumps straight to its settings instead of ramping there
+    if (stateRestored.compareAndSetBool(false, true))
+        updateFilters();
     
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    // a recalled program arrives fully designed; only the latest one matters
+    ChainDesign programDesign;
+    auto numProgramDesigns = 0;
     
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    while (programDesignFifo.pull(programDesign))
+        ++numProgramDesigns;
     
-    updateFilters();
+    if (numProgramDesigns > 0)
+    {
+        programChangesInFlight -= numProgramDesigns;
+        pendingProgramDesign = programDesign;
+        programDesignPending = true;
+    }
+    
+    // Cutting a running crossfade short would drop the outgoing chain mid-ramp and click, so a
+    // recall waits for it to finish. Later recalls replace the waiting one.
+    if (programDesignPending && fadingChain == nullptr)
+    {
+        programDesignPending = false;
+        switchToProgramDesign(pendingProgramDesign);
+    }
+    
+    // settings are picked up before processing, so they apply to this block rather than the next
+    if (programChangesInFlight.load() == 0 && !programDesignPending && chainSmoother.setTargets(getChainSettings(apvts)))
+        chainDesignPending = true;
     
-    leftChannelFifo.update(buffer);
-    rightChannelFifo.update(buffer);
+    const auto numSamples = buffer.getNumSamples();
+    const auto blockStart = getBlockStartPosition();
+    
+    if (!chainDesignPending && !chainSmoother.isSmoothing())
+    {
+        // static parameters: one pass, no design work
+        processChain(mainBuffer, 0, numSamples);
+    }
+    else
+    {
+        // The block is only split on a control grid anchored to the timeline position, never
+        // relative to the block start, so designs land on the same samples whatever the
+        // buffer size is.
+        constexpr int grid = ChainSettingsSmoother::fastUpdateInterval;
+        
+        for (int start = 0; start < numSamples; )
+        {
+            const auto position = blockStart + start;
+            const auto offset = int(((position % grid) + grid) % grid); // pre-roll positions can be negative
+            
+            if (offset == 0 && (chainSmoother.isSmoothing() || chainDesignPending))
+            {
+                const auto isOnSlowGrid = position % ChainSettingsSmoother::slowUpdateInterval == 0;
+                const auto isMovingFast = chainSmoother.isMovingFast();
+                auto needsDesign = chainDesignPending || isOnSlowGrid || isMovingFast;
+                
+                // the ramps advance on every grid point so their timing doesn't depend on the design rate
+                const auto& settings = chainSmoother.advance(grid);
+                
+                // a ramp can finish between slow grid points, and nothing would design its end point
+                needsDesign = needsDesign || !chainSmoother.isSmoothing();
+                
+                if (needsDesign)
+                {
+                    // glide the state-variable engine until the next design is due
+                    const auto rampSamples = isMovingFast || !isOnSlowGrid ? grid : ChainSettingsSmoother::slowUpdateInterval;
+                    chainDesignPending = false;
+                    updateChainFilters(settings, rampSamples);
+                }
+            }
+            
+            const auto length = juce::jmin(grid - offset, numSamples - start);
+            processChain(mainBuffer, start, length);
+            
+            start += length;
+        }
+    }
+    
+    internalSamplePosition = blockStart + numSamples;
+    
+    updateBandBank();
+    updateDynamicBands();
+    
+    bandBank.process(mainBuffer);
+    dynamicBands.process(mainBuffer, &sidechainBuffer);
+    
+    const auto isCapturing = analyzerConsumerPresent.get();
+    
+    if (isCapturing)
+    {
+        // start both channels on a fresh buffer boundary so they stay in lockstep
+        if (!wasCapturing)
+        {
+            leftChannelFifo.resync();
+            rightChannelFifo.resync();
+        }
+        
+        // only the main bus: the sidechain is a key signal, not part of what the EQ outputs
+        leftChannelFifo.update(mainBuffer);
+        rightChannelFifo.update(mainBuffer);
+    }
+    
+    wasCapturing = isCapturing;
 }
 
 //==============================================================================
@@ -193,8 +451,7 @@ void SimpleEQAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
     
-    juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    BinaryState::write(getParameters(), destData);
 }
 
 void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -202,49 +459,202 @@ void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBy
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
     
+    // the filters are redesigned on the audio thread, on the next processBlock or prepareToPlay
+    if (BinaryState::read(data, sizeInBytes, getParameters()))
+    {
+        stateRestored.set(true);
+        return;
+    }
+    
+    // sessions saved before the binary format hold the ValueTree
     auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
     if (tree.isValid())
     {
         apvts.replaceState(tree);
-        updateFilters();
+        stateRestored.set(true);
     }
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+//==============================================================================
+void ChainSettingsSmoother::prepare(double newSampleRate, const ChainSettings& initial)
+{
+    sampleRate = newSampleRate;
+    setCurrent(initial);
+}
+
+void ChainSettingsSmoother::setRampTime(float milliseconds)
+{
+    const auto seconds = juce::jmax(0.0, milliseconds * 0.001);
+    
+    // reset() jumps to the target, so carry the current values over
+    lowCutFreq.reset(sampleRate, seconds);
+    highCutFreq.reset(sampleRate, seconds);
+    peakFreq.reset(sampleRate, seconds);
+    peakQuality.reset(sampleRate, seconds);
+    peakGainInDecibels.reset(sampleRate, seconds);
+    
+    lowCutFreq.setCurrentAndTargetValue(current.lowCutFreq);
+    highCutFreq.setCurrentAndTargetValue(current.highCutFreq);
+    peakFreq.setCurrentAndTargetValue(current.peakFreq);
+    peakQuality.setCurrentAndTargetValue(current.peakQuality);
+    peakGainInDecibels.setCurrentAndTargetValue(current.peakGainInDecibels);
+    
+    current.smoothingTimeMs = milliseconds;
+}
+
+void ChainSettingsSmoother::setCurrent(const ChainSettings& settings)
+{
+    current = settings;
+    targets = settings;
+    setRampTime(settings.smoothingTimeMs);
+}
+
+bool ChainSettingsSmoother::setTargets(const ChainSettings& newTargets)
+{
+    const auto changed = newTargets.lowCutFreq != targets.lowCutFreq
+                      || newTargets.highCutFreq != targets.highCutFreq
+                      || newTargets.peakFreq != targets.peakFreq
+                      || newTargets.peakQuality != targets.peakQuality
+                      || newTargets.peakGainInDecibels != targets.peakGainInDecibels
+                      || newTargets.lowCutSlope != targets.lowCutSlope
+                      || newTargets.highCutSlope != targets.highCutSlope
+                      || newTargets.lowCutBypassed != targets.lowCutBypassed
+                      || newTargets.peakBypassed != targets.peakBypassed
+                      || newTargets.highCutBypassed != targets.highCutBypassed
+                      || newTargets.filterEngine != targets.filterEngine;
+    
+    if (newTargets.smoothingTimeMs != current.smoothingTimeMs)
+        setRampTime(newTargets.smoothingTimeMs);
+    
+    targets = newTargets;
+    
+    lowCutFreq.setTargetValue(targets.lowCutFreq);
+    highCutFreq.setTargetValue(targets.highCutFreq);
+    peakFreq.setTargetValue(targets.peakFreq);
+    peakQuality.setTargetValue(targets.peakQuality);
+    peakGainInDecibels.setTargetValue(targets.peakGainInDecibels);
+    
+    current.lowCutSlope = targets.lowCutSlope;
+    current.highCutSlope = targets.highCutSlope;
+    current.lowCutBypassed = targets.lowCutBypassed;
+    current.peakBypassed = targets.peakBypassed;
+    current.highCutBypassed = targets.highCutBypassed;
+    current.filterEngine = targets.filterEngine;
+    
+    return changed;
+}
+
+bool ChainSettingsSmoother::isSmoothing() const
+{
+    return lowCutFreq.isSmoothing()
+        || highCutFreq.isSmoothing()
+        || peakFreq.isSmoothing()
+        || peakQuality.isSmoothing()
+        || peakGainInDecibels.isSmoothing();
+}
+
+bool ChainSettingsSmoother::isMovingFast() const
+{
+    // look at how far each value would move over a slow interval, by advancing copies
+    auto octavesMoved = [](MultiplicativeSmoother probe)
+    {
+        const auto before = probe.getCurrentValue();
+        return std::abs(std::log2(probe.skip(slowUpdateInterval) / before));
+    };
+    
+    auto probeGain = peakGainInDecibels;
+    const auto gainMoved = std::abs(probeGain.skip(slowUpdateInterval) - peakGainInDecibels.getCurrentValue());
+    
+    // a quarter of a semitone or a quarter of a dB per slow interval starts to sound stepped
+    constexpr float maxOctaves = 1.f / 48.f;
+    constexpr float maxDecibels = 0.25f;
+    
+    return octavesMoved(lowCutFreq) > maxOctaves
+        || octavesMoved(highCutFreq) > maxOctaves
+        || octavesMoved(peakFreq) > maxOctaves
+        || octavesMoved(peakQuality) > maxOctaves
+        || gainMoved > maxDecibels;
+}
+
+const ChainSettings& ChainSettingsSmoother::advance(int numSamples)
+{
+    current.lowCutFreq = lowCutFreq.skip(numSamples);
+    current.highCutFreq = highCutFreq.skip(numSamples);
+    current.peakFreq = peakFreq.skip(numSamples);
+    current.peakQuality = peakQuality.skip(numSamples);
+    current.peakGainInDecibels = peakGainInDecibels.skip(numSamples);
+    
+    return current;
+}
+
+/** getValue returns the plain (denormalised) value of the parameter with the given ID. */
+template<typename ValueGetter>
+static ChainSettings readChainSettings(ValueGetter getValue)
 {
     ChainSettings settings;
     
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq")->load();
-    settings.highCutFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
-    settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
-    settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
-    settings.lowCutSlope = static_cast<Slope>(apvts.getRawParameterValue("LowCut Slope")->load());
-    settings.highCutSlope = static_cast<Slope>(apvts.getRawParameterValue("HighCut Slope")->load());
-    settings.lowCutBypassed = apvts.getRawParameterValue("LowCut Bypassed")->load() > 0.5f;
-    settings.peakBypassed = apvts.getRawParameterValue("Peak Bypassed")->load() > 0.5f;
-    settings.highCutBypassed = apvts.getRawParameterValue("HighCut Bypassed")->load() > 0.5f;
+    settings.lowCutFreq = getValue("LowCut Freq");
+    settings.highCutFreq = getValue("HighCut Freq");
+    settings.peakFreq = getValue("Peak Freq");
+    settings.peakGainInDecibels = getValue("Peak Gain");
+    settings.peakQuality = getValue("Peak Quality");
+    settings.lowCutSlope = static_cast<Slope>(getValue("LowCut Slope"));
+    settings.highCutSlope = static_cast<Slope>(getValue("HighCut Slope"));
+    settings.lowCutBypassed = getValue("LowCut Bypassed") > 0.5f;
+    settings.peakBypassed = getValue("Peak Bypassed") > 0.5f;
+    settings.highCutBypassed = getValue("HighCut Bypassed") > 0.5f;
+    settings.filterEngine = static_cast<FilterEngine>(getValue("Filter Engine"));
+    settings.smoothingTimeMs = getValue("Smoothing Time");
     
     return settings;
 }
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+{
+    return readChainSettings([&apvts](const char* parameterID)
+    {
+        return apvts.getRawParameterValue(parameterID)->load();
+    });
+}
+
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts, const std::vector<float>& values)
+{
+    return readChainSettings([&apvts, &values](const char* parameterID)
+    {
+        auto* parameter = apvts.getParameter(parameterID);
+        return parameter->convertFrom0to1(values[(size_t)parameter->getParameterIndex()]);
+    });
+}
+
+ChainDesign makeChainDesign(const ChainSettings& chainSettings, double sampleRate)
 {
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate,
-                                                               chainSettings.peakFreq,
-                                                               chainSettings.peakQuality,
-                                                               juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
+    ChainDesign design;
+    design.settings = chainSettings;
+    
+    if (sampleRate <= 0.0)
+        return design;
+    
+    designButterworthCut(true, chainSettings.lowCutFreq, sampleRate, 2 * (chainSettings.lowCutSlope + 1), design.lowCut);
+    designButterworthCut(false, chainSettings.highCutFreq, sampleRate, 2 * (chainSettings.highCutSlope + 1), design.highCut);
+    
+    design.peak = designPeak(chainSettings.peakFreq,
+                             chainSettings.peakQuality,
+                             chainSettings.peakGainInDecibels,
+                             sampleRate);
+    design.sampleRate = sampleRate;
+    
+    return design;
 }
 
-void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings)
+void SimpleEQAudioProcessor::updatePeakFilter(ChainInstance& chain, const ChainDesign& design)
 {
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
+    const auto& chainSettings = design.settings;
     
-    leftChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    rightChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
+    chain.leftChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
+    chain.rightChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
     
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    updateCoefficients(chain.leftChain.get<ChainPositions::Peak>().coefficients, design.peak);
+    updateCoefficients(chain.rightChain.get<ChainPositions::Peak>().coefficients, design.peak);
 }
 
 void updateCoefficients(Coefficients &old, const Coefficients &replacements)
@@ -252,38 +662,380 @@ void updateCoefficients(Coefficients &old, const Coefficients &replacements)
     *old = *replacements;
 }
 
-void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings& chainSettings)
+void updateCoefficients(Coefficients &old, const BiquadCoefficients &replacements)
 {
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    auto& raw = old->coefficients;
     
-    leftChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    rightChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
+    // a default constructed filter holds a first order placeholder, so only the first update resizes
+    if (raw.size() != (int)replacements.size())
+        raw.resize((int)replacements.size());
     
-    updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
+    std::copy(replacements.begin(), replacements.end(), raw.begin());
 }
 
-void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings& chainSettings)
+void SimpleEQAudioProcessor::updateLowCutFilters(ChainInstance& chain, const ChainDesign& design)
 {
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
+    const auto& chainSettings = design.settings;
+    
+    auto& leftLowCut = chain.leftChain.get<ChainPositions::LowCut>();
+    auto& rightLowCut = chain.rightChain.get<ChainPositions::LowCut>();
+    
+    chain.leftChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
+    chain.rightChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
+    
+    updateCutFilter(leftLowCut, design.lowCut, chainSettings.lowCutSlope);
+    updateCutFilter(rightLowCut, design.lowCut, chainSettings.lowCutSlope);
+}
+
+void SimpleEQAudioProcessor::updateHighCutFilters(ChainInstance& chain, const ChainDesign& design)
+{
+    const auto& chainSettings = design.settings;
+    
+    auto& leftHighCut = chain.leftChain.get<ChainPositions::HighCut>();
+    auto& rightHighCut = chain.rightChain.get<ChainPositions::HighCut>();
     
-    leftChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-    rightChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+    chain.leftChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+    chain.rightChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
     
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+    updateCutFilter(leftHighCut, design.highCut, chainSettings.highCutSlope);
+    updateCutFilter(rightHighCut, design.highCut, chainSettings.highCutSlope);
 }
 
 void SimpleEQAudioProcessor::updateFilters()
 {
+    // nothing can be designed before the sample rate is known; prepareToPlay calls this again
+    if (getSampleRate() <= 0.0)
+        return;
+    
     auto chainSettings = getChainSettings(apvts);
-    updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilters(chainSettings);
+    chainSmoother.setCurrent(chainSettings);
+    
+    // a jump anyway, so the engine switches in place rather than fading
+    activeChain->setEngine(resolveEngine(chainSettings));
+    updateChainFilters(chainSettings);
+    updateBandBank();
+    updateDynamicBands();
+}
+
+juce::int64 SimpleEQAudioProcessor::getBlockStartPosition()
+{
+    if (auto* playHead = getPlayHead())
+    {
+       #if JUCE_MAJOR_VERSION >= 7
+        if (auto position = playHead->getPosition())
+        {
+            if (auto timeInSamples = position->getTimeInSamples())
+                return *timeInSamples;
+        }
+       #else
+        juce::AudioPlayHead::CurrentPositionInfo position;
+        if (playHead->getCurrentPosition(position))
+            return position.timeInSamples;
+       #endif
+    }
+    
+    return internalSamplePosition;
+}
+
+void SimpleEQAudioProcessor::updateChainFilters(const ChainSettings& chainSettings, int rampSamples)
+{
+    const auto design = makeChainDesign(chainSettings, getSampleRate());
+    const auto engine = resolveEngine(chainSettings);
+    
+    if (engine != activeChain->activeEngine)
+    {
+        // Neither engine's state means anything to the other, so the new engine starts on the
+        // other instance and fades in. Both instances are busy during a fade, so try again after it.
+        if (fadingChain != nullptr)
+        {
+            chainDesignPending = true;
+        }
+        else
+        {
+            if (fadeBuffer.getNumSamples() > 0)
+                startCrossfade(engine, getEngineSwitchFadeSamples(chainSettings));
+            else
+                activeChain->setEngine(engine);
+            
+            // nothing to glide from on an engine that has just started
+            rampSamples = 0;
+        }
+    }
+    
+    applyChainDesign(*activeChain, design, rampSamples);
+}
+
+void SimpleEQAudioProcessor::startCrossfade(FilterEngine incomingEngine, int fadeSamples)
+{
+    // the outgoing chain keeps ringing on its own state while the new one starts from silence
+    auto* incoming = activeChain == &chainInstances[0] ? &chainInstances[1] : &chainInstances[0];
+    incoming->reset();
+    incoming->activeEngine = incomingEngine;
+    
+    fadingChain = activeChain;
+    activeChain = incoming;
+    fadeLength = fadeSamplesRemaining = fadeSamples;
+}
+
+int SimpleEQAudioProcessor::getEngineSwitchFadeSamples(const ChainSettings& chainSettings) const
+{
+    // like a recall, but never instant: switching engines in place always clicks
+    constexpr float minFadeMs = 10.f;
+    return juce::roundToInt(juce::jmax(minFadeMs, chainSettings.smoothingTimeMs) * 0.001 * getSampleRate());
+}
+
+void SimpleEQAudioProcessor::applyChainDesign(ChainInstance& chain, const ChainDesign& design, int rampSamples)
+{
+    updateLowCutFilters(chain, design);
+    updatePeakFilter(chain, design);
+    updateHighCutFilters(chain, design);
+    updateSvfEngine(chain, design.settings, rampSamples);
+}
+
+void SimpleEQAudioProcessor::switchToProgramDesign(const ChainDesign& design)
+{
+    // recalled before the sample rate was known
+    const auto& current = design.sampleRate == getSampleRate() ? design
+                                                               : makeChainDesign(design.settings, getSampleRate());
+    
+    chainSmoother.setCurrent(current.settings);
+    chainDesignPending = false;
+    
+    // the smoothing time doubles as the crossfade time, so 0 ms switches instantly
+    const auto fadeSamples = juce::roundToInt(current.settings.smoothingTimeMs * 0.001 * getSampleRate());
+    
+    if (fadeSamples > 0 && fadeBuffer.getNumSamples() > 0)
+        startCrossfade(resolveEngine(current.settings), fadeSamples);
+    else
+        activeChain->setEngine(resolveEngine(current.settings));
+    
+    applyChainDesign(*activeChain, current);
+}
+
+void SimpleEQAudioProcessor::processChain(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    while (fadingChain != nullptr && numSamples > 0)
+    {
+        const auto length = juce::jmin(numSamples, fadeSamplesRemaining, fadeBuffer.getNumSamples());
+        const auto numChannels = juce::jmin(buffer.getNumChannels(), fadeBuffer.getNumChannels());
+        
+        for (int ch = 0; ch < numChannels; ++ch)
+            fadeBuffer.copyFrom(ch, 0, buffer, ch, startSample, length);
+        
+        processChainInstance(*fadingChain, fadeBuffer, 0, length);
+        processChainInstance(*activeChain, buffer, startSample, length);
+        
+        // the chains see the same input, so a linear crossfade keeps the level constant
+        const auto done = fadeLength - fadeSamplesRemaining;
+        const auto startGain = float(done) / float(fadeLength);
+        const auto endGain = float(done + length) / float(fadeLength);
+        
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            buffer.applyGainRamp(ch, startSample, length, startGain, endGain);
+            buffer.addFromWithRamp(ch, startSample, fadeBuffer.getReadPointer(ch), length, 1.f - startGain, 1.f - endGain);
+        }
+        
+        startSample += length;
+        numSamples -= length;
+        fadeSamplesRemaining -= length;
+        
+        if (fadeSamplesRemaining == 0)
+            fadingChain = nullptr;
+    }
+    
+    if (numSamples > 0)
+        processChainInstance(*activeChain, buffer, startSample, numSamples);
+}
+
+void SimpleEQAudioProcessor::processChainInstance(ChainInstance& chain, juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    // buffer only holds the main bus, which may be mono
+    if (chain.activeEngine == FilterEngine::Engine_StateVariable)
+    {
+        juce::AudioBuffer<float> range(buffer.getArrayOfWritePointers(),
+                                       buffer.getNumChannels(),
+                                       startSample,
+                                       numSamples);
+        chain.svfEngine.process(range);
+        return;
+    }
+    
+    juce::dsp::AudioBlock<float> block(buffer);
+    block = block.getSubBlock((size_t)startSample, (size_t)numSamples);
+    
+    auto leftBlock = block.getSingleChannelBlock(0);
+    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
+    chain.leftChain.process(leftContext);
+    
+    if (block.getNumChannels() > 1)
+    {
+        auto rightBlock = block.getSingleChannelBlock(1);
+        juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+        chain.rightChain.process(rightContext);
+    }
+}
+
+void SimpleEQAudioProcessor::updateSvfEngine(ChainInstance& chain, const ChainSettings& chainSettings, int rampSamples)
+{
+    // a single tan per filter, so keeping the inactive engine's coefficients current is cheap
+    chain.svfEngine.setLowCut(chainSettings.lowCutFreq, 2 * (chainSettings.lowCutSlope + 1), chainSettings.lowCutBypassed);
+    chain.svfEngine.setPeak(chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDecibels, chainSettings.peakBypassed);
+    chain.svfEngine.setHighCut(chainSettings.highCutFreq, 2 * (chainSettings.highCutSlope + 1), chainSettings.highCutBypassed);
+    
+    // an engine that isn't running jumps, so it is current whenever it gets switched to
+    chain.svfEngine.rampToTargets(chain.activeEngine == FilterEngine::Engine_StateVariable ? rampSamples : 0);
+}
+
+FilterEngine SimpleEQAudioProcessor::resolveEngine(const ChainSettings& chainSettings) const
+{
+    if (chainSettings.filterEngine != FilterEngine::Engine_Auto)
+        return chainSettings.filterEngine;
+    
+    return calibratedEngines[(size_t)(chainSettings.lowCutSlope * numSlopes + chainSettings.highCutSlope)];
+}
+
+void SimpleEQAudioProcessor::calibrateEngines(double sampleRate, int samplesPerBlock)
+{
+    if (sampleRate <= 0.0 || samplesPerBlock <= 0)
+        return;
+    
+    // the main bus is what the chain runs on, and the engines only ever see up to two channels
+    const auto numChannels = juce::jlimit(1, SvfFilterEngine::maxChannels, getMainBusNumInputChannels());
+    
+    const auto key = EngineCalibration::makeKey(sampleRate, samplesPerBlock, numChannels);
+    auto result = engineCalibration->find(key);
+    
+    if (result.length() != (int)calibratedEngines.size())
+    {
+        result = timeEngines(sampleRate, samplesPerBlock, numChannels);
+        engineCalibration->store(key, result);
+    }
+    
+    // one digit per slope pair, the winning FilterEngine
+    for (size_t i = 0; i < calibratedEngines.size(); ++i)
+    {
+        const auto digit = juce::jlimit(0, (int)FilterEngine::Engine_Auto - 1, (int)(result[(int)i] - '0'));
+        calibratedEngines[i] = static_cast<FilterEngine>(digit);
+    }
+    
+    enginesAreCalibrated = true;
+}
+
+juce::String SimpleEQAudioProcessor::timeEngines(double sampleRate, int samplesPerBlock, int numChannels)
+{
+    // each engine gets the best of a few blocks, interleaved so neither always runs on a cold cache
+    constexpr int numRuns = 4;
+    
+    juce::ScopedNoDenormals noDenormals;
+    
+    juce::dsp::ProcessSpec spec;
+    spec.maximumBlockSize = (juce::uint32)samplesPerBlock;
+    spec.numChannels = 1;
+    spec.sampleRate = sampleRate;
+    
+    auto chain = std::make_unique<ChainInstance>();
+    chain->prepare(spec);
+    
+    juce::AudioBuffer<float> buffer(numChannels, samplesPerBlock);
+    juce::Random random(1);
+    
+    // a typical setting with every filter engaged; only the slopes change what the engines cost
+    ChainSettings settings;
+    settings.lowCutFreq = 80.f;
+    settings.highCutFreq = 12000.f;
+    settings.peakFreq = 1000.f;
+    settings.peakGainInDecibels = 3.f;
+    settings.peakQuality = 1.f;
+    
+    juce::String result;
+    
+    for (int lowCutSlope = 0; lowCutSlope < numSlopes; ++lowCutSlope)
+    {
+        for (int highCutSlope = 0; highCutSlope < numSlopes; ++highCutSlope)
+        {
+            settings.lowCutSlope = static_cast<Slope>(lowCutSlope);
+            settings.highCutSlope = static_cast<Slope>(highCutSlope);
+            
+            auto design = makeChainDesign(settings, sampleRate);
+            std::array<juce::int64, FilterEngine::Engine_Auto> bestTicks;
+            bestTicks.fill(std::numeric_limits<juce::int64>::max());
+            
+            for (int run = 0; run < numRuns; ++run)
+            {
+                for (size_t engine = 0; engine < bestTicks.size(); ++engine)
+                {
+                    design.settings.filterEngine = static_cast<FilterEngine>(engine);
+                    chain->setEngine(design.settings.filterEngine);
+                    applyChainDesign(*chain, design);
+                    
+                    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                    {
+                        auto* samples = buffer.getWritePointer(ch);
+                        for (int i = 0; i < samplesPerBlock; ++i)
+                            samples[i] = 0.25f * (2.f * random.nextFloat() - 1.f);
+                    }
+                    
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    processChainInstance(*chain, buffer, 0, samplesPerBlock);
+                    const auto elapsed = juce::Time::getHighResolutionTicks() - start;
+                    
+                    bestTicks[engine] = juce::jmin(bestTicks[engine], elapsed);
+                }
+            }
+            
+            const auto winner = std::min_element(bestTicks.begin(), bestTicks.end()) - bestTicks.begin();
+            result << (int)winner;
+        }
+    }
+    
+    return result;
+}
+
+void SimpleEQAudioProcessor::ChainInstance::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    leftChain.prepare(spec);
+    rightChain.prepare(spec);
+    svfEngine.prepare(spec.sampleRate);
+}
+
+void SimpleEQAudioProcessor::ChainInstance::reset()
+{
+    leftChain.reset();
+    rightChain.reset();
+    svfEngine.reset();
+}
+
+void SimpleEQAudioProcessor::ChainInstance::setEngine(FilterEngine engine)
+{
+    if (engine == activeEngine)
+        return;
+    
+    // start the engine being switched to from silence rather than from stale state
+    if (engine == FilterEngine::Engine_StateVariable)
+    {
+        svfEngine.reset();
+    }
+    else
+    {
+        leftChain.reset();
+        rightChain.reset();
+    }
+    
+    activeEngine = engine;
+}
+
+void SimpleEQAudioProcessor::updateBandBank()
+{
+    // unchanged bands are skipped inside setBand, so this only costs a comparison per band
+    for (int i = 0; i < BandBank::maxBands; ++i)
+        bandBank.setBand(i, bandParameters[i].load());
+}
+
+void SimpleEQAudioProcessor::updateDynamicBands()
+{
+    for (int i = 0; i < DynamicBands::numBands; ++i)
+        dynamicBands.setBand(i, dynamicBandParameters[i].load());
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::createParameterLayout()
@@ -323,6 +1075,68 @@ juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::crea
     layout.add(std::make_unique<juce::AudioParameterBool>("HighCut Bypassed", "HighCut Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>("Analyzer Enabled", "Analyzer Enabled", true));
     
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Smoothing Time",
+                                                           "Smoothing Time",
+                                                           juce::NormalisableRange<float>(0.f, 200.f, 1.f, 0.5f), 20.f));
+    
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Filter Engine",
+                                                            "Filter Engine",
+                                                            juce::StringArray { "Direct Form", "State Variable", "Auto" },
+                                                            0));
+    
+    for (int i = 0; i < BandBank::maxBands; ++i)
+    {
+        // spread the default frequencies log-evenly so newly enabled bands don't stack up
+        auto defaultFreq = std::round(juce::mapToLog10((i + 0.5f) / BandBank::maxBands, 20.f, 20000.f));
+        
+        layout.add(std::make_unique<juce::AudioParameterChoice>(getBandParameterID(i, "Type"),
+                                                                getBandParameterID(i, "Type"),
+                                                                getBandTypeNames(), 0));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getBandParameterID(i, "Freq"),
+                                                               getBandParameterID(i, "Freq"),
+                                                               juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), defaultFreq));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getBandParameterID(i, "Gain"),
+                                                               getBandParameterID(i, "Gain"),
+                                                               juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f), 0.0f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getBandParameterID(i, "Quality"),
+                                                               getBandParameterID(i, "Quality"),
+                                                               juce::NormalisableRange<float>(0.1, 10.f, 0.05f, 1.f), 1.f));
+        layout.add(std::make_unique<juce::AudioParameterBool>(getBandParameterID(i, "Bypassed"),
+                                                              getBandParameterID(i, "Bypassed"),
+                                                              true));
+    }
+    
+    for (int i = 0; i < DynamicBands::numBands; ++i)
+    {
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getDynamicBandParameterID(i, "Freq"),
+                                                               getDynamicBandParameterID(i, "Freq"),
+                                                               juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 6000.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getDynamicBandParameterID(i, "Quality"),
+                                                               getDynamicBandParameterID(i, "Quality"),
+                                                               juce::NormalisableRange<float>(0.1, 10.f, 0.05f, 1.f), 2.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getDynamicBandParameterID(i, "Threshold"),
+                                                               getDynamicBandParameterID(i, "Threshold"),
+                                                               juce::NormalisableRange<float>(-60.f, 0.f, 0.5f, 1.f), -24.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getDynamicBandParameterID(i, "Ratio"),
+                                                               getDynamicBandParameterID(i, "Ratio"),
+                                                               juce::NormalisableRange<float>(1.f, 20.f, 0.1f, 0.5f), 4.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getDynamicBandParameterID(i, "Range"),
+                                                               getDynamicBandParameterID(i, "Range"),
+                                                               juce::NormalisableRange<float>(-24.f, 0.f, 0.5f, 1.f), -12.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getDynamicBandParameterID(i, "Attack"),
+                                                               getDynamicBandParameterID(i, "Attack"),
+                                                               juce::NormalisableRange<float>(0.1f, 100.f, 0.1f, 0.4f), 1.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getDynamicBandParameterID(i, "Release"),
+                                                               getDynamicBandParameterID(i, "Release"),
+                                                               juce::NormalisableRange<float>(5.f, 1000.f, 1.f, 0.4f), 60.f));
+        layout.add(std::make_unique<juce::AudioParameterBool>(getDynamicBandParameterID(i, "Sidechain"),
+                                                              getDynamicBandParameterID(i, "Sidechain"),
+                                                              false));
+        layout.add(std::make_unique<juce::AudioParameterBool>(getDynamicBandParameterID(i, "Bypassed"),
+                                                              getDynamicBandParameterID(i, "Bypassed"),
+                                                              true));
+    }
+    
     return layout;
 }
 
@@ -10,6 +10,11 @@
 
 #include <JuceHeader.h>
 #include <array>
+#include "BandBank.h"
+#include "DynamicBands.h"
+#include "SvfFilterEngine.h"
+#include "CoefficientDesign.h"
+#include "EngineCalibration.h"
 
 template<typename T>
 struct Fifo
@@ -91,8 +96,10 @@ struct SingleChannelSampleFifo
     void update(const BlockType& buffer)
     {
         jassert(prepared.get());
-        jassert(buffer.getNumChannels() > channelToUse);
-        auto* channelPtr = buffer.getReadPointer(channelToUse);
+        jassert(buffer.getNumChannels() > 0);
+        
+        // a mono buffer feeds both channels' fifos
+        auto* channelPtr = buffer.getReadPointer(juce::jmin((int)channelToUse, buffer.getNumChannels() - 1));
         
         for( int i = 0; i < buffer.getNumSamples(); ++i )
         {
@@ -100,6 +107,15 @@ struct SingleChannelSampleFifo
         }
     }
     
+    /**
+     Drops the partially filled buffer so capture restarts on a buffer boundary.
+     Must be called from the thread that calls update().
+     */
+    void resync()
+    {
+        fifoIndex = 0;
+    }
+    
     void prepare(int bufferSize)
     {
         prepared.set(false);
@@ -152,16 +168,100 @@ enum Slope
     Slope_48
 };
 
+enum FilterEngine
+{
+    Engine_DirectForm,
+    Engine_StateVariable,
+    /**
+     Whichever engine prepareToPlay timed fastest for the current slopes. Opt-in, as the choice
+     can differ between machines; Direct Form is the default.
+     */
+    Engine_Auto
+};
+
 struct ChainSettings
 {
     float peakFreq { 0 }, peakGainInDecibels { 0 }, peakQuality {1.f};
     float lowCutFreq { 0 }, highCutFreq { 0 };
     Slope lowCutSlope { Slope::Slope_12 }, highCutSlope { Slope::Slope_12 };
     bool lowCutBypassed { false }, peakBypassed { false }, highCutBypassed { false };
+    FilterEngine filterEngine { FilterEngine::Engine_DirectForm };
+    float smoothingTimeMs { 20.f };
 };
 
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
 
+/** The settings that a set of normalised values, in getParameters() order, would give. */
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts, const std::vector<float>& values);
+
+/** Every coefficient of the main chain, designed ahead of time for one sample rate. */
+struct ChainDesign
+{
+    ChainSettings settings;
+    CutFilterDesign lowCut {}, highCut {};
+    BiquadCoefficients peak {};
+    double sampleRate { 0.0 };
+};
+
+ChainDesign makeChainDesign(const ChainSettings& chainSettings, double sampleRate);
+
+/**
+ A complete set of parameter values, along with the main chain designed from them, so recalling
+ it hands the audio thread finished coefficients instead of settings to design from.
+ */
+struct Program
+{
+    juce::String name;
+    std::vector<float> values; // normalised, in getParameters() order
+    ChainDesign design;
+    
+    bool isEmpty() const { return values.empty(); }
+};
+
+/**
+ Ramps the continuous chain settings (frequencies, peak gain and Q) towards their targets.
+ 
+ Frequencies and Q are smoothed multiplicatively and gain in dB, so every intermediate setting is a
+ valid filter and the coefficients designed from it are stable. The caller advances it on a
+ 16 sample control grid and redesigns on every grid point while a value moves quickly, on every
+ other one while it drifts, and not at all once everything has settled. Other settings follow
+ their targets at once.
+ 
+ The state-variable engine glides per sample from one design to the next. The direct-form chain
+ steps between them, which stays inaudible because a drifting value moves less than
+ isMovingFast()'s thresholds per step and a faster one is redesigned twice as often.
+ */
+struct ChainSettingsSmoother
+{
+    static constexpr int fastUpdateInterval = 16;
+    static constexpr int slowUpdateInterval = 32;
+    
+    void prepare(double sampleRate, const ChainSettings& initial);
+    
+    /** Jumps straight to the given settings. */
+    void setCurrent(const ChainSettings& settings);
+    /** Returns true if any setting differs from the previous targets. */
+    bool setTargets(const ChainSettings& newTargets);
+    
+    bool isSmoothing() const;
+    
+    /** True while a value moves fast enough that designing every slowUpdateInterval would sound stepped. */
+    bool isMovingFast() const;
+    
+    /** Advances by numSamples and returns the settings at the end of that span. */
+    const ChainSettings& advance(int numSamples);
+private:
+    using MultiplicativeSmoother = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>;
+    
+    MultiplicativeSmoother lowCutFreq, highCutFreq, peakFreq, peakQuality;
+    juce::SmoothedValue<float> peakGainInDecibels;
+    
+    ChainSettings current, targets;
+    double sampleRate = 44100.0;
+    
+    void setRampTime(float milliseconds);
+};
+
 using Filter = juce::dsp::IIR::Filter<float>;
 using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
 using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
@@ -175,8 +275,7 @@ enum ChainPositions
 
 using Coefficients = Filter::CoefficientsPtr;
 void updateCoefficients(Coefficients &old, const Coefficients &replacements);
-
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
+void updateCoefficients(Coefficients &old, const BiquadCoefficients &replacements);
 
 template<int Index, typename ChainType, typename CoefficientType>
 void update(ChainType& chain, const CoefficientType& coefficients)
@@ -219,20 +318,6 @@ void updateCutFilter(ChainType& lowCut,
     }
 }
 
-inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
-{
-    return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq,
-                                                                                       sampleRate,
-                                                                                       2 * (chainSettings.lowCutSlope + 1));
-}
-
-inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
-{
-    return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq,
-                                                                                      sampleRate,
-                                                                                      2 * (chainSettings.highCutSlope + 1));
-}
-
 //==============================================================================
 /**
 */
@@ -240,6 +325,7 @@ class SimpleEQAudioProcessor  : public juce::AudioProcessor
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
+                             , private juce::Timer
 {
 public:
     //==============================================================================
@@ -285,14 +371,124 @@ public:
     using BlockType = juce::AudioBuffer<float>;
     SingleChannelSampleFifo<BlockType> leftChannelFifo { Channel::Left };
     SingleChannelSampleFifo<BlockType> rightChannelFifo { Channel::Right };
+    
+    /**
+     Set by the analyzer while it is consuming the channel fifos. While it is false processBlock
+     doesn't copy anything into them, so instances without a visible analyzer pay nothing.
+     A consumer should drain the fifos before setting this, as they may hold stale buffers.
+     */
+    void setAnalyzerConsumerPresent(bool isPresent) { analyzerConsumerPresent.set(isPresent); }
+
+    /**
+     A/B comparison. Selecting the other snapshot stores the current settings in the one being
+     left, then recalls the selected one. A snapshot that was never stored starts as a copy of the
+     current settings. Message thread only.
+     */
+    void selectSnapshot(int index);
+    int getCurrentSnapshot() const { return currentSnapshot; }
+    
+    static constexpr int numSnapshots = 2;
 
 private:
-    MonoChain leftChain, rightChain;
+    /** One main chain: both direct-form channels and the state-variable engine. */
+    struct ChainInstance
+    {
+        MonoChain leftChain, rightChain;
+        SvfFilterEngine svfEngine;
+        FilterEngine activeEngine { FilterEngine::Engine_DirectForm };
+        
+        void prepare(const juce::dsp::ProcessSpec& spec);
+        void reset();
+        
+        /** Switches in place, clearing the engine switched to. Clicks if audio is running through it. */
+        void setEngine(FilterEngine engine);
+    };
+    
+    /**
+     Two instances, so a recalled program or a different engine can start on a fresh chain while
+     the outgoing one fades out on its own state. Switching is a swap of these pointers, and only
+     happens once the previous fade has finished.
+     */
+    std::array<ChainInstance, 2> chainInstances;
+    ChainInstance* activeChain = &chainInstances[0];
+    ChainInstance* fadingChain = nullptr;
+    
+    juce::AudioBuffer<float> fadeBuffer;
+    int fadeLength = 0, fadeSamplesRemaining = 0;
+    
+    std::vector<Program> programs;
+    std::array<Program, numSnapshots> snapshots;
+    int currentProgram = 0, currentSnapshot = 0;
+    
+    Fifo<ChainDesign> programDesignFifo;
+    std::atomic<int> programChangesInFlight { 0 };
+    
+    /** The latest recall, held on the audio thread until the crossfade in progress has finished. */
+    ChainDesign pendingProgramDesign;
+    bool programDesignPending = false;
+    
+    static constexpr int numSlopes = Slope_48 + 1;
+    
+    /** The fastest engine for each slope pair, indexed by lowCutSlope * numSlopes + highCutSlope. */
+    std::array<FilterEngine, numSlopes * numSlopes> calibratedEngines {};
+    
+    juce::SharedResourcePointer<EngineCalibration> engineCalibration;
+    
+    /**
+     Only Auto reads calibratedEngines, so prepareToPlay only fills them while Auto is selected.
+     If it is picked later, the timer fills them on the message thread with processing suspended.
+     */
+    std::atomic<bool> enginesAreCalibrated { false };
+    bool isAutoEngineSelected() const;
+    void timerCallback() override;
+    
+    /** Loads the timings for this configuration, or measures and stores them if there are none. */
+    void calibrateEngines(double sampleRate, int samplesPerBlock);
+    juce::String timeEngines(double sampleRate, int samplesPerBlock, int numChannels);
+    
+    /** The concrete engine to run for chainSettings, resolving Engine_Auto. */
+    FilterEngine resolveEngine(const ChainSettings& chainSettings) const;
+    
+    Program captureProgram(const juce::String& name);
+    void recallProgram(Program& program);
+    void switchToProgramDesign(const ChainDesign& design);
+    
+    /** Starts the other instance from silence on incomingEngine and fades over to it. */
+    void startCrossfade(FilterEngine incomingEngine, int fadeSamples);
+    int getEngineSwitchFadeSamples(const ChainSettings& chainSettings) const;
+    
+    ChainSettingsSmoother chainSmoother;
+    bool chainDesignPending = true;
+    juce::Atomic<bool> stateRestored { false };
+    juce::int64 internalSamplePosition = 0;
+    
+    /** The timeline position of the block from the host, or a running count if it has none. */
+    juce::int64 getBlockStartPosition();
+    
+    BandBank bandBank;
+    std::array<BandParameters, BandBank::maxBands> bandParameters;
+    
+    DynamicBands dynamicBands;
+    std::array<DynamicBandParameters, DynamicBands::numBands> dynamicBandParameters;
+    
+    juce::Atomic<bool> analyzerConsumerPresent { false };
+    bool wasCapturing = false;
+    
+    void updatePeakFilter(ChainInstance& chain, const ChainDesign& design);
+    
+    void updateLowCutFilters(ChainInstance& chain, const ChainDesign& design);
+    void updateHighCutFilters(ChainInstance& chain, const ChainDesign& design);
+    
+    /** rampSamples is how long the state-variable engine takes to glide to the new settings; 0 jumps. */
+    void updateSvfEngine(ChainInstance& chain, const ChainSettings& chainSettings, int rampSamples);
+    void updateBandBank();
+    void updateDynamicBands();
     
-    void updatePeakFilter(const ChainSettings& chainSettings);
+    void updateChainFilters(const ChainSettings& chainSettings, int rampSamples = 0);
+    void applyChainDesign(ChainInstance& chain, const ChainDesign& design, int rampSamples = 0);
     
-    void updateLowCutFilters(const ChainSettings& chainSettings);
-    void updateHighCutFilters(const ChainSettings& chainSettings);
+    void processChain(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void processChainInstance(ChainInstance& chain, juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
     
     void updateFilters();
     
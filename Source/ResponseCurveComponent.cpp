@@ -7,52 +7,190 @@
 
 #include "ResponseCurveComponent.h"
 
-void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
+void PathProducer::setAnalysisMode(AnalysisMode newMode)
 {
-    juce::AudioBuffer<float> tempIncomingBuffer;
+    if( newMode == analysisMode )
+        return;
     
-    while ( fifo->getNumCompleteBuffersAvailable() > 0 )
+    analysisMode = newMode;
+    
+    // the frame layout differs between the modes, so the smoother starts over;
+    // the multi-resolution layout is only known once it has been prepared for a sample rate
+    if( analysisMode == AnalysisMode::SingleResolution )
     {
-        if( fifo->getAudioBuffer(tempIncomingBuffer) )
+        smoother.prepare(fftDataGenerator.getFFTSize(), -48.f);
+        
+        // the history stopped being fed when the mode was left, so it only holds old audio
+        leftMonoBuffer.clear();
+        rightMonoBuffer.clear();
+        preparedSampleRate = 0.0;
+    }
+    else
+        multiResolutionAnalyzer.reset();
+}
+
+void PathProducer::discardPendingAudio()
+{
+    while( leftFifo->getNumCompleteBuffersAvailable() > 0 && leftFifo->getAudioBuffer(tempIncomingBuffer) ) { }
+    while( rightFifo->getNumCompleteBuffersAvailable() > 0 && rightFifo->getAudioBuffer(tempIncomingRightBuffer) ) { }
+    
+    leftMonoBuffer.clear();
+    rightMonoBuffer.clear();
+    
+    // re-preparing resets the decimators and the multi-resolution histories
+    preparedSampleRate = 0.0;
+    multiResolutionAnalyzer.reset();
+}
+
+bool PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
+{
+    if( analysisMode == AnalysisMode::MultiResolution )
+        return processMultiResolution(fftBounds, sampleRate);
+    
+    if( sampleRate <= 0.0 )
+        return false;
+    
+    // above 48k the signal is band-limited and decimated to the display range first, so the FFT
+    // cost and bin width stay what they are at 44.1k/48k
+    if( sampleRate != preparedSampleRate )
+    {
+        preparedSampleRate = sampleRate;
+        
+        leftDecimator.prepareForDisplayRange(sampleRate);
+        rightDecimator.prepareForDisplayRange(sampleRate);
+        analysisSampleRate = sampleRate / leftDecimator.getFactor();
+        samplesSinceLastFrame = 0;
+    }
+    
+    // one FFT per host block's worth of decimated samples, as often as at the base rate
+    const auto hopSize = juce::jmax(1, leftFifo->getSize());
+    
+    // both channel fifos are filled by the same processBlock call, so they can be consumed in lockstep
+    while ( leftFifo->getNumCompleteBuffersAvailable() > 0 && rightFifo->getNumCompleteBuffersAvailable() > 0 )
+    {
+        if( !leftFifo->getAudioBuffer(tempIncomingBuffer) || !rightFifo->getAudioBuffer(tempIncomingRightBuffer) )
+            continue;
+        
+        const auto numSamples = tempIncomingBuffer.getNumSamples();
+        
+        if( (int)leftDecimated.size() < numSamples )
         {
-            auto size = tempIncomingBuffer.getNumSamples();
-            
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
-                                              monoBuffer.getReadPointer(0, size),
-                                              monoBuffer.getNumSamples() - size);
-            
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size),
-                                              tempIncomingBuffer.getReadPointer(0, 0),
-                                              size);
-            
-            fftDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
+            leftDecimated.resize(numSamples);
+            rightDecimated.resize(numSamples);
+        }
+        
+        const auto numDecimated = leftDecimator.process(tempIncomingBuffer.getReadPointer(0), numSamples, leftDecimated.data());
+        rightDecimator.process(tempIncomingRightBuffer.getReadPointer(0), numSamples, rightDecimated.data());
+        
+        appendToAnalysisHistory(leftMonoBuffer, leftDecimated.data(), numDecimated);
+        appendToAnalysisHistory(rightMonoBuffer, rightDecimated.data(), numDecimated);
+        
+        samplesSinceLastFrame += numDecimated;
+        
+        if( samplesSinceLastFrame >= hopSize )
+        {
+            samplesSinceLastFrame = 0;
+            fftDataGenerator.produceFFTDataForRendering(leftMonoBuffer, rightMonoBuffer, -48.f);
         }
     }
     
     const auto fftSize = fftDataGenerator.getFFTSize();
-    const auto binWidth = sampleRate / (double)fftSize;
+    const auto numBins = fftDataGenerator.getNumBins();
+    const auto binWidth = analysisSampleRate / (double)fftSize;
+    
+    const auto frameInterval = float(hopSize / analysisSampleRate);
+    
+    // every frame goes through the smoother, but only the newest one is turned into vertices
+    bool hasNewFrame = false;
     
     while( fftDataGenerator.getNumAvailableFFTDataBlocks() > 0 )
     {
-        std::vector<float> fftData;
         if( fftDataGenerator.getFFTData(fftData) )
         {
-            pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.0);
+            if( spectrogram != nullptr )
+                spectrogram->pushFrame(fftData.data(), fftData.data() + numBins, numBins, (float)binWidth, -48.f);
+            
+            smoother.process(fftData.data(), frameInterval);
+            hasNewFrame = true;
+        }
+    }
+    
+    if( hasNewFrame && spectrogram == nullptr )
+    {
+        leftPathGenerator.generatePath(fftData.data(), fftBounds, fftSize, binWidth, -48.0);
+        rightPathGenerator.generatePath(fftData.data() + numBins, fftBounds, fftSize, binWidth, -48.0);
+        
+        if( isShowingPeaks() )
+        {
+            leftPeakGenerator.generatePath(smoother.getPeakData(), fftBounds, fftSize, binWidth, -48.0);
+            rightPeakGenerator.generatePath(smoother.getPeakData() + numBins, fftBounds, fftSize, binWidth, -48.0);
+        }
+    }
+    
+    return hasNewFrame;
+}
+
+bool PathProducer::processMultiResolution(juce::Rectangle<float> fftBounds, double sampleRate)
+{
+    if( sampleRate <= 0.0 )
+        return false;
+    
+    auto& analyzer = multiResolutionAnalyzer;
+    
+    if( sampleRate != analyzer.getPreparedSampleRate() )
+    {
+        analyzer.prepare(sampleRate, -48.f);
+        smoother.prepare(2 * analyzer.getNumValuesPerChannel(), -48.f);
+    }
+    
+    const auto valuesPerChannel = analyzer.getNumValuesPerChannel();
+    bool hasNewFrame = false;
+    
+    while ( leftFifo->getNumCompleteBuffersAvailable() > 0 && rightFifo->getNumCompleteBuffersAvailable() > 0 )
+    {
+        if( !leftFifo->getAudioBuffer(tempIncomingBuffer) || !rightFifo->getAudioBuffer(tempIncomingRightBuffer) )
+            continue;
+        
+        if( !analyzer.pushBlock(tempIncomingBuffer.getReadPointer(0),
+                                tempIncomingRightBuffer.getReadPointer(0),
+                                tempIncomingBuffer.getNumSamples()) )
+            continue;
+        
+        if( spectrogram != nullptr )
+        {
+            const auto& topBandFrame = analyzer.getTopBandFrame();
+            const auto numBins = analyzer.getTopBandNumBins();
+            spectrogram->pushFrame(topBandFrame.data(), topBandFrame.data() + numBins, numBins, analyzer.getTopBandBinWidth(), -48.f);
         }
+        
+        fftData = analyzer.getFrame();
+        smoother.process(fftData.data(), analyzer.getFrameIntervalSeconds());
+        hasNewFrame = true;
     }
     
-    while (pathProducer.getNumPathsAvailable())
+    if( hasNewFrame && spectrogram == nullptr )
     {
-        pathProducer.getPath(fftPath);
+        const auto& binFrequencies = analyzer.getBinFrequencies();
+        
+        leftPathGenerator.generatePath(fftData.data(), binFrequencies, fftBounds, -48.f);
+        rightPathGenerator.generatePath(fftData.data() + valuesPerChannel, binFrequencies, fftBounds, -48.f);
+        
+        if( isShowingPeaks() )
+        {
+            leftPeakGenerator.generatePath(smoother.getPeakData(), binFrequencies, fftBounds, -48.f);
+            rightPeakGenerator.generatePath(smoother.getPeakData() + valuesPerChannel, binFrequencies, fftBounds, -48.f);
+        }
     }
+    
+    return hasNewFrame;
 }
 
 //==============================================================================
 
 ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) :
 audioProcessor(p),
-leftPathProducer(audioProcessor.leftChannelFifo),
-rightPathProducer(audioProcessor.rightChannelFifo)
+pathProducer(audioProcessor.leftChannelFifo, audioProcessor.rightChannelFifo),
+visibilityWatcher(*this)
 {
     const auto& params = audioProcessor.getParameters();
     for ( auto param : params )
@@ -60,13 +198,19 @@ rightPathProducer(audioProcessor.rightChannelFifo)
         param->addListener(this);
     }
     
+    // looked up by ID once, so a parameter change doesn't cost a lookup per band parameter
+    for ( int i = 0; i < BandBank::maxBands; ++i )
+        bandParameters[i].attachTo(audioProcessor.apvts, i);
+    
     updateChain();
     
-    startTimerHz(60);
+    updateAnalyzerPacerState();
 }
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
+    audioProcessor.setAnalyzerConsumerPresent(false);
+    
     const auto& params = audioProcessor.getParameters();
     for ( auto param : params )
     {
@@ -79,23 +223,105 @@ void ResponseCurveComponent::parameterValueChanged (int parameterIndex, float ne
     parametersChanged.set(true);
 }
 
-void ResponseCurveComponent::timerCallback()
+void ResponseCurveComponent::updateCurveIfChanged()
 {
-    if (shouldShowFFTAnalysis)
+    bool curveChanged = false;
+    
+    if (parametersChanged.compareAndSetBool(false, true))
     {
-        const auto fftBounds = getAnalysisArea().toFloat();
-        const auto sampleRate = audioProcessor.getSampleRate();
-        
-        leftPathProducer.process(fftBounds, sampleRate);
-        rightPathProducer.process(fftBounds, sampleRate);
+        updateChain();
+        curveChanged = true;
     }
-
-    if (parametersChanged.compareAndSetBool(false, true))
+    
+    if (audioProcessor.getSampleRate() != curveSampleRate)
     {
+        // the chain's coefficients were designed for the old rate too
         updateChain();
+        curveChanged = true;
+    }
+    
+    if (curveChanged)
+    {
+        updateResponseCurve();
+        repaint(getRenderArea());
     }
+}
+
+void ResponseCurveComponent::updateAnalyzer()
+{
+    updateCurveIfChanged();
+    
+    const auto fftBounds = getAnalysisArea().toFloat();
+    const auto sampleRate = audioProcessor.getSampleRate();
+    
+    if (pathProducer.process(fftBounds, sampleRate))
+    {
+        // the spectrogram has already written its new column, the spectrum lines need redrawing
+        if (analyzerView == AnalyzerView::Spectrum)
+            spectrumLayerIsDirty = true;
+        
+        repaint(getRenderArea());
+    }
+}
+
+void ResponseCurveComponent::setAnalyzerView(AnalyzerView newView)
+{
+    if (newView == analyzerView)
+        return;
+    
+    analyzerView = newView;
+    
+    spectrogram.clear();
+    pathProducer.setSpectrogram(analyzerView == AnalyzerView::Spectrogram ? &spectrogram : nullptr);
+    
+    spectrumLayerIsDirty = true;
+    repaint(getRenderArea());
+}
+
+void ResponseCurveComponent::setAnalysisMode(PathProducer::AnalysisMode newMode)
+{
+    if (newMode == pathProducer.getAnalysisMode())
+        return;
+    
+    pathProducer.setAnalysisMode(newMode);
     
-    repaint();
+    // the two modes' frames don't line up, so the old lines and spectrogram rows are dropped
+    spectrogram.clear();
+    spectrumLayerIsDirty = true;
+    repaint(getRenderArea());
+}
+
+void ResponseCurveComponent::updateAnalyzerPacerState()
+{
+    if (shouldShowFFTAnalysis && isShowing())
+    {
+        if (!analyzerPacer.isRunning())
+        {
+            // the fifos stopped being fed when the analyzer went away, so whatever is left in them is stale
+            pathProducer.discardPendingAudio();
+            audioProcessor.setAnalyzerConsumerPresent(true);
+            analyzerPacer.start();
+        }
+        
+        // the pacer's frames poll for curve changes now
+        stopTimer();
+    }
+    else
+    {
+        analyzerPacer.stop();
+        audioProcessor.setAnalyzerConsumerPresent(false);
+        
+        if (!isTimerRunning())
+            startTimerHz(idlePollHz);
+    }
+}
+
+void ResponseCurveComponent::toggleAnalysisEnabled(bool enabled)
+{
+    shouldShowFFTAnalysis = enabled;
+    spectrumLayerIsDirty = true;
+    updateAnalyzerPacerState();
+    repaint(getRenderArea());
 }
 
 void ResponseCurveComponent::updateChain()
@@ -107,81 +333,90 @@ void ResponseCurveComponent::updateChain()
     monoChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
     monoChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
     
-    auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-    updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    // nothing can be designed before the sample rate is known; it is picked up again once it is
+    if (audioProcessor.getSampleRate() > 0.0)
+    {
+        // designs are shared between instances, so identical settings are only designed once
+        const auto design = sharedResources->getChainDesign(chainSettings, audioProcessor.getSampleRate());
+        
+        updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, design.peak);
+        updateCutFilter(monoChain.get<ChainPositions::LowCut>(), design.lowCut, chainSettings.lowCutSlope);
+        updateCutFilter(monoChain.get<ChainPositions::HighCut>(), design.highCut, chainSettings.highCutSlope);
+    }
     
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
+    if (displayBands.getSampleRate() != audioProcessor.getSampleRate())
+        displayBands.prepare(audioProcessor.getSampleRate());
     
-    updateCutFilter(monoChain.get<ChainPositions::LowCut>(), lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(monoChain.get<ChainPositions::HighCut>(), highCutCoefficients, chainSettings.highCutSlope);
+    for (int i = 0; i < BandBank::maxBands; ++i)
+        displayBands.setBand(i, bandParameters[i].load());
 }
 
-void ResponseCurveComponent::paint (juce::Graphics& g)
+void ResponseCurveComponent::updateResponseCurve()
 {
     using namespace juce;
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll (Colours::black);
     
-    g.drawImage(background, getLocalBounds().toFloat());
-
     auto responseArea = getAnalysisArea();
     
-    auto width = responseArea.getWidth();
-    
     auto& lowcut = monoChain.get<ChainPositions::LowCut>();
     auto& peak = monoChain.get<ChainPositions::Peak>();
     auto& highcut = monoChain.get<ChainPositions::HighCut>();
     
     auto sampleRate = audioProcessor.getSampleRate();
+    curveSampleRate = sampleRate;
+    responseCurveX = (float)responseArea.getX();
     
-    std::vector<double> mags;
+    responseCurveEvaluator.prepare(responseArea.getWidth(), sampleRate);
+    responseCurveEvaluator.clearSections();
     
-    mags.resize(width);
+    if (!monoChain.isBypassed<ChainPositions::Peak>())
+        responseCurveEvaluator.addSection(*peak.coefficients);
     
-    for ( auto i=0; i < width; ++i )
+    if (!monoChain.isBypassed<ChainPositions::LowCut>())
     {
-        double mag = 1.f;
-        auto freq = mapToLog10(double(i) / double(width), 20.0, 20000.0);
-        
-        if (!monoChain.isBypassed<ChainPositions::Peak>())
-            mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        
-        if (!monoChain.isBypassed<ChainPositions::LowCut>())
-        {
-            if (!lowcut.isBypassed<0>())
-                mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<1>())
-                mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<2>())
-                mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<3>())
-                mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        
-        if (!monoChain.isBypassed<ChainPositions::HighCut>())
-        {
-            if (!highcut.isBypassed<0>())
-                mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<1>())
-                mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<2>())
-                mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<3>())
-                mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        
-        mags[i] = Decibels::gainToDecibels(mag);
+        if (!lowcut.isBypassed<0>())
+            responseCurveEvaluator.addSection(*lowcut.get<0>().coefficients);
+        if (!lowcut.isBypassed<1>())
+            responseCurveEvaluator.addSection(*lowcut.get<1>().coefficients);
+        if (!lowcut.isBypassed<2>())
+            responseCurveEvaluator.addSection(*lowcut.get<2>().coefficients);
+        if (!lowcut.isBypassed<3>())
+            responseCurveEvaluator.addSection(*lowcut.get<3>().coefficients);
+    }
+    
+    if (!monoChain.isBypassed<ChainPositions::HighCut>())
+    {
+        if (!highcut.isBypassed<0>())
+            responseCurveEvaluator.addSection(*highcut.get<0>().coefficients);
+        if (!highcut.isBypassed<1>())
+            responseCurveEvaluator.addSection(*highcut.get<1>().coefficients);
+        if (!highcut.isBypassed<2>())
+            responseCurveEvaluator.addSection(*highcut.get<2>().coefficients);
+        if (!highcut.isBypassed<3>())
+            responseCurveEvaluator.addSection(*highcut.get<3>().coefficients);
+    }
+    
+    for (int i = 0; i < displayBands.getNumActiveBands(); ++i)
+    {
+        auto c = displayBands.getActiveBandCoefficients(i);
+        responseCurveEvaluator.addSection(c[0], c[1], c[2], c[3], c[4]);
     }
     
-    Path responseCurve;
+    responseCurveEvaluator.evaluate();
+    responseCurveLayerIsDirty = true;
     
-    const double outputMin = responseArea.getBottom();
-    const double outputMax = responseArea.getY();
+    const auto& mags = responseCurveEvaluator.getMagnitudesInDecibels();
     
-    auto map = [outputMin, outputMax](double input)
+    responseCurve.clear();
+    
+    if( mags.empty() )
+        return;
+    
+    const float outputMin = responseArea.getBottom();
+    const float outputMax = responseArea.getY();
+    
+    auto map = [outputMin, outputMax](float input)
     {
-        return jmap(input, -24.0, 24.0, outputMin, outputMax);
+        return jmap(input, -24.f, 24.f, outputMin, outputMax);
     };
     
     responseCurve.startNewSubPath(responseArea.getX(), map(mags.front()));
@@ -190,21 +425,82 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
     {
         responseCurve.lineTo(responseArea.getX() + i, map(mags[i]));
     }
+}
+
+void ResponseCurveComponent::paint (juce::Graphics& g)
+{
+    using namespace juce;
     
-    if( shouldShowFFTAnalysis )
+    if (spectrumLayer.isNull())
     {
-        auto leftChannelFFTPath = leftPathProducer.getPath();
-        leftChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
-        
-        g.setColour(Colours::skyblue);
-        g.strokePath(leftChannelFFTPath, PathStrokeType(1.f));
-        
-        auto rightChannelFFTPath = rightPathProducer.getPath();
-        rightChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
+        g.fillAll(Colours::black);
+        return;
+    }
+    
+    if (gridLayerIsDirty)
+        renderGridLayer();
+    
+    // the spectrogram view never shows the layer, so it stays dirty until the view switches back
+    if (spectrumLayerIsDirty && analyzerView == AnalyzerView::Spectrum)
+    {
+        const auto startMs = Time::getMillisecondCounterHiRes();
+        renderSpectrumLayer();
+        analyzerPacer.addPaintCost(Time::getMillisecondCounterHiRes() - startMs);
+    }
+    
+    if (responseCurveLayerIsDirty)
+        renderResponseCurveLayer();
+    
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    background.drawAt(g, 0, 0);
+    
+    if (shouldShowFFTAnalysis)
+    {
+        if (analyzerView == AnalyzerView::Spectrogram)
+            spectrogram.draw(g);
+        else
+            g.drawImageAt(spectrumLayer, 0, 0);
+    }
+    
+    g.drawImageAt(responseCurveLayer, 0, 0);
+}
+
+void ResponseCurveComponent::renderSpectrumLayer()
+{
+    using namespace juce;
+    
+    spectrumLayerIsDirty = false;
+    spectrumLayer.clear(spectrumLayer.getBounds());
+    
+    if (!shouldShowFFTAnalysis || analyzerView != AnalyzerView::Spectrum)
+        return;
+    
+    Graphics g(spectrumLayer);
+    
+    g.setColour(Colours::skyblue);
+    strokePolyline(g, pathProducer.getLeftPolyline());
+    
+    g.setColour(Colours::lightyellow);
+    strokePolyline(g, pathProducer.getRightPolyline());
+    
+    if( pathProducer.isShowingPeaks() )
+    {
+        g.setColour(Colours::skyblue.withAlpha(0.5f));
+        strokePolyline(g, pathProducer.getLeftPeakPolyline());
         
-        g.setColour(Colours::lightyellow);
-        g.strokePath(rightChannelFFTPath, PathStrokeType(1.f));
+        g.setColour(Colours::lightyellow.withAlpha(0.5f));
+        strokePolyline(g, pathProducer.getRightPeakPolyline());
     }
+}
+
+void ResponseCurveComponent::renderResponseCurveLayer()
+{
+    using namespace juce;
+    
+    responseCurveLayerIsDirty = false;
+    responseCurveLayer.clear(responseCurveLayer.getBounds());
+    
+    Graphics g(responseCurveLayer);
     
     g.setColour(Colours::orange);
     g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
@@ -213,12 +509,49 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
     g.strokePath(responseCurve, PathStrokeType(2.f));
 }
 
+void ResponseCurveComponent::strokePolyline(juce::Graphics& g, const AnalyzerPathGenerator::Polyline& polyline)
+{
+    if( polyline.empty() )
+        return;
+    
+    // clear() keeps the path's storage, so refilling it every frame doesn't allocate
+    analyzerPath.clear();
+    analyzerPath.startNewSubPath(polyline.front());
+    
+    for( size_t i = 1; i < polyline.size(); ++i )
+        analyzerPath.lineTo(polyline[i]);
+    
+    g.strokePath(analyzerPath, juce::PathStrokeType(1.f));
+}
+
 void ResponseCurveComponent::resized()
 {
     using namespace juce;
-    background = Image(Image::PixelFormat::RGB, getWidth(), getHeight(), true);
     
-    Graphics g(background);
+    spectrumLayer = Image(Image::PixelFormat::ARGB, getWidth(), getHeight(), true);
+    responseCurveLayer = Image(Image::PixelFormat::ARGB, getWidth(), getHeight(), true);
+    
+    gridLayerIsDirty = true;
+    spectrumLayerIsDirty = true;
+    spectrogram.setBounds(getAnalysisArea());
+    
+    updateResponseCurve();
+}
+
+void ResponseCurveComponent::renderGridLayer()
+{
+    gridLayerIsDirty = false;
+    
+    // the grid only depends on the size, so editors of the same size share one image
+    background = sharedResources->getGridImage(getWidth(), getHeight(),
+                                               [this](juce::Graphics& g) { drawGrid(g); });
+}
+
+void ResponseCurveComponent::drawGrid(juce::Graphics& g)
+{
+    using namespace juce;
+    
+    g.fillAll(Colours::black);
     
     Array<float> freqs
     {
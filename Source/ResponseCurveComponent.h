@@ -7,159 +7,340 @@
 
 #import <JuceHeader.h>
 #import "PluginProcessor.h"
+#import "FFTDataGenerator.h"
+#import "MultiResolutionAnalyzer.h"
+#import "ResponseCurveEvaluator.h"
+#import "FramePacer.h"
+#import "Spectrogram.h"
+#import "SharedResourcePool.h"
 
-enum FFTOrder {
-    order2048 = 11,
-    order4096 = 12,
-    order8192 = 13
-};
-
-template<typename BlockType>
-struct FFTDataGenerator
+/**
+ Exponential averaging and peak-hold for analyzer frames.
+ Both are applied in place on the dB data, so a calm display doesn't require larger or more
+ frequent FFTs. The per-bin loops are branch-free so they vectorise.
+ */
+struct SpectrumSmoother
 {
-    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
+    enum class PeakHoldMode
     {
-        const auto fftSize = getFFTSize();
-        
-        fftData.assign(fftData.size(), 0);
-        auto* readIndex = audioData.getReadPointer(0);
-        std::copy(readIndex, readIndex + fftSize, fftData.begin());
-        
-        window->multiplyWithWindowingTable(fftData.data(), fftSize);
-        
-        forwardFFT->performFrequencyOnlyForwardTransform(fftData.data());
-        
-        int numBins = (int)fftSize / 2;
-        
-        for( int i = 0; i < numBins; ++i )
-        {
-            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
-        }
+        Off,
+        HoldAndDecay,
+        Infinite
+    };
+    
+    void prepare(int numValues, float negativeInfinity)
+    {
+        floorDb = negativeInfinity;
+        averaged.assign(numValues, floorDb);
+        peak.assign(numValues, floorDb);
+        holdRemaining.assign(numValues, 0.f);
+        isFirstFrame = true;
+    }
+    
+    void reset()
+    {
+        std::fill(peak.begin(), peak.end(), floorDb);
+        std::fill(holdRemaining.begin(), holdRemaining.end(), 0.f);
+        isFirstFrame = true;
+    }
+    
+    /** 0 turns averaging off. */
+    void setAveragingTime(float milliseconds) { averagingSeconds = juce::jmax(0.f, milliseconds * 0.001f); }
+    
+    void setPeakHold(PeakHoldMode newMode, float holdMilliseconds, float decayDbPerSecond)
+    {
+        if( newMode != peakHoldMode )
+            reset();
         
-        fftDataFifo.push(fftData);
+        peakHoldMode = newMode;
+        holdSeconds = juce::jmax(0.f, holdMilliseconds * 0.001f);
+        peakDecayDbPerSecond = juce::jmax(0.f, decayDbPerSecond);
     }
     
-    void changeOrder(FFTOrder newOrder)
+    PeakHoldMode getPeakHoldMode() const { return peakHoldMode; }
+    
+    /** Averages frame in place and updates the held peaks. frameInterval is the hop between frames. */
+    void process(float* frame, float frameIntervalSeconds)
     {
-        // when you change order, recreate the window, forwardFFT, fifo, fftData
-        // also reset the fifoIndex
-        // things that need recreating should be created on the heap via std::make_unique<>
+        const auto numValues = (int)averaged.size();
         
-        order = newOrder;
-        auto fftSize = getFFTSize();
+        const auto alpha = (averagingSeconds > 0.f && !isFirstFrame)
+                         ? 1.f - std::exp(-frameIntervalSeconds / averagingSeconds)
+                         : 1.f;
         
-        forwardFFT = std::make_unique<juce::dsp::FFT>(order);
-        window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
+        auto* avg = averaged.data();
+        for( int i = 0; i < numValues; ++i )
+        {
+            avg[i] += alpha * (frame[i] - avg[i]);
+            frame[i] = avg[i];
+        }
         
-        fftData.clear();
-        fftData.resize(fftSize * 2, 0);
+        auto* pk = peak.data();
         
-        fftDataFifo.prepare(fftData.size());
+        if( peakHoldMode == PeakHoldMode::Infinite )
+        {
+            for( int i = 0; i < numValues; ++i )
+                pk[i] = juce::jmax(pk[i], frame[i]);
+        }
+        else if( peakHoldMode == PeakHoldMode::HoldAndDecay )
+        {
+            const auto decay = peakDecayDbPerSecond * frameIntervalSeconds;
+            auto* hold = holdRemaining.data();
+            
+            for( int i = 0; i < numValues; ++i )
+            {
+                const auto isNewPeak = frame[i] >= pk[i];
+                const auto decayed = hold[i] > 0.f ? pk[i] : pk[i] - decay;
+                
+                pk[i] = isNewPeak ? frame[i] : juce::jmax(decayed, frame[i]);
+                hold[i] = isNewPeak ? holdSeconds : hold[i] - frameIntervalSeconds;
+            }
+        }
+        
+        isFirstFrame = false;
     }
     
-    //==============================================================================
-    int getFFTSize() const { return 1 << order; }
-    int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading(); }
-    //==============================================================================
-    bool getFFTData(BlockType& fftData) { return fftDataFifo.pull(fftData); }
+    const float* getPeakData() const { return peak.data(); }
 private:
-    FFTOrder order;
-    BlockType fftData;
-    std::unique_ptr<juce::dsp::FFT> forwardFFT;
-    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
-    Fifo<BlockType> fftDataFifo;
+    std::vector<float> averaged, peak, holdRemaining;
+    float floorDb = -48.f;
+    float averagingSeconds = 0.1f;
+    float holdSeconds = 1.f;
+    float peakDecayDbPerSecond = 12.f;
+    PeakHoldMode peakHoldMode = PeakHoldMode::Off;
+    bool isFirstFrame = true;
 };
 
-template<typename PathType>
+/**
+ Turns FFT frames into a polyline in component coordinates.
+ The vertices are written into one of two preallocated buffers and the buffers are swapped
+ once the frame is complete, so nothing is allocated unless the column mapping changes.
+ */
 struct AnalyzerPathGenerator
 {
-    void generatePath(const std::vector<float>& renderData,
+    using Polyline = std::vector<juce::Point<float>>;
+    
+    enum class ColumnAggregation
+    {
+        Peak,
+        RMS
+    };
+    
+    void generatePath(const float* renderData,
                       juce::Rectangle<float> fftBounds,
                       int fftSize,
                       float binWidth,
                       float negativeInfinity)
     {
+        updateColumnMapping(fftSize / 2, [binWidth](int binNum) { return binNum * binWidth; }, fftBounds.getWidth());
+        buildPolyline(renderData, fftBounds, negativeInfinity);
+    }
+    
+    /**
+     For frames whose values aren't evenly spaced, e.g. stitched multi-resolution frames.
+     binFrequencies must be ascending; like bin 0 of a plain FFT frame, the first value only sets
+     the level the line starts at.
+     */
+    void generatePath(const float* renderData,
+                      const std::vector<float>& binFrequencies,
+                      juce::Rectangle<float> fftBounds,
+                      float negativeInfinity)
+    {
+        updateColumnMapping((int)binFrequencies.size(), [&binFrequencies](int i) { return binFrequencies[i]; }, fftBounds.getWidth());
+        buildPolyline(renderData, fftBounds, negativeInfinity);
+    }
+    
+    void setColumnAggregation(ColumnAggregation newAggregation) { aggregation = newAggregation; }
+    
+    /** The most recently completed polyline. */
+    const Polyline& getPolyline() const { return polylines[frontIndex]; }
+private:
+    /** A run of consecutive bins that all land on the same pixel column. */
+    struct Column
+    {
+        float x;
+        int firstBin;
+        int numBins;
+    };
+    
+    std::vector<Column> columns;
+    int mappedNumBins = 0;
+    float mappedLowestFreq = 0.f, mappedHighestFreq = 0.f, mappedWidth = 0.f;
+    ColumnAggregation aggregation = ColumnAggregation::Peak;
+    std::array<Polyline, 2> polylines;
+    int frontIndex = 0;
+    
+    template<typename FrequencyOfBin>
+    void updateColumnMapping(int numBins, FrequencyOfBin frequencyOfBin, float width)
+    {
+        if( numBins < 2 )
+        {
+            columns.clear();
+            mappedNumBins = numBins;
+            return;
+        }
+        
+        const auto lowestFreq = frequencyOfBin(1);
+        const auto highestFreq = frequencyOfBin(numBins - 1);
+        
+        if( numBins == mappedNumBins && lowestFreq == mappedLowestFreq && highestFreq == mappedHighestFreq && width == mappedWidth )
+            return;
+        
+        mappedNumBins = numBins;
+        mappedLowestFreq = lowestFreq;
+        mappedHighestFreq = highestFreq;
+        mappedWidth = width;
+        
+        columns.clear();
+        columns.reserve((size_t)juce::jmax(0, (int)width) + 2);
+        
+        for( int binNum = 1; binNum < numBins; ++binNum )
+        {
+            auto binFreq = frequencyOfBin(binNum);
+            auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
+            auto binX = (float)std::floor(normalizedBinX * width);
+            
+            if( !columns.empty() && columns.back().x == binX )
+            {
+                ++columns.back().numBins;
+                continue;
+            }
+            
+            // the first column past the right edge is kept so the line reaches the border
+            if( !columns.empty() && columns.back().x > width )
+                break;
+            
+            columns.push_back({ binX, binNum, 1 });
+        }
+        
+        for( auto& polyline : polylines )
+            polyline.reserve(columns.size() + 1);
+    }
+    
+    void buildPolyline(const float* renderData, juce::Rectangle<float> fftBounds, float negativeInfinity)
+    {
+        auto left = fftBounds.getX();
         auto top = fftBounds.getY();
-        auto bottom = fftBounds.getHeight();
-        auto width = fftBounds.getWidth();
+        auto bottom = fftBounds.getBottom();
         
-        int numBins = (int)fftSize / 2;
+        auto& polyline = polylines[1 - frontIndex];
+        polyline.clear();
         
-        PathType p;
-        p.preallocateSpace(3 * (int)fftBounds.getWidth());
+        if( mappedNumBins < 2 )
+            return;
         
         auto map = [bottom, top, negativeInfinity](float v)
         {
             return juce::jmap(v,
                               negativeInfinity, 0.f,
-                              float(bottom), top);
+                              bottom, top);
         };
         
         auto y = map(renderData[0]);
         
         jassert(!std::isnan(y) && !std::isinf(y));
         
-        p.startNewSubPath(0, y);
-        
-        const int pathResolution = 2;
+        polyline.emplace_back(left, y);
         
-        for( int binNum = 1; binNum < numBins; binNum += pathResolution )
+        for( const auto& column : columns )
         {
-            y = map(renderData[binNum]);
+            y = map(aggregate(renderData + column.firstBin, column.numBins));
             
             jassert(!std::isnan(y) && !std::isinf(y));
             
             if (!std::isnan(y) && !std::isinf(y))
             {
-                auto binFreq = binNum * binWidth;
-                auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
-                int binX = std::floor(normalizedBinX * width);
-                p.lineTo(binX, y);
+                polyline.emplace_back(left + column.x, y);
             }
         }
         
-        pathFifo.push(p);
-    }
-    
-    int getNumPathsAvailable() const
-    {
-        return pathFifo.getNumAvailableForReading();
+        frontIndex = 1 - frontIndex;
     }
     
-    bool getPath(PathType& path)
+    float aggregate(const float* bins, int numBins) const
     {
-        return pathFifo.pull(path);
+        if( numBins == 1 )
+            return bins[0];
+        
+        if( aggregation == ColumnAggregation::Peak )
+            return *std::max_element(bins, bins + numBins);
+        
+        float power = 0.f;
+        for( int i = 0; i < numBins; ++i )
+            power += std::pow(10.f, bins[i] * 0.1f);
+        
+        return 10.f * std::log10(power / (float)numBins);
     }
-private:
-    Fifo<PathType> pathFifo;
 };
 
 struct PathProducer
 {
-    PathProducer(SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>& scsf) :
-    fifo(&scsf)
+    enum class AnalysisMode
+    {
+        /** One order2048 FFT of the full-rate signal. */
+        SingleResolution,
+        /** Stitched FFTs of progressively decimated bands, see MultiResolutionAnalyzer. */
+        MultiResolution
+    };
+    
+    PathProducer(SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>& leftScsf,
+                 SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>& rightScsf) :
+    leftFifo(&leftScsf),
+    rightFifo(&rightScsf)
     {
         fftDataGenerator.changeOrder(FFTOrder::order2048);
-        monoBuffer.setSize(1, fftDataGenerator.getFFTSize());
+        leftMonoBuffer.setSize(1, fftDataGenerator.getFFTSize());
+        rightMonoBuffer.setSize(1, fftDataGenerator.getFFTSize());
+        smoother.prepare(fftDataGenerator.getFFTSize(), -48.f);
     }
     
-    void process(juce::Rectangle<float> fftBounds, double sampleRate);
-    juce::Path getPath() { return fftPath; }
+    /** Returns true if a new frame was produced. */
+    bool process(juce::Rectangle<float> fftBounds, double sampleRate);
+    const AnalyzerPathGenerator::Polyline& getLeftPolyline() const { return leftPathGenerator.getPolyline(); }
+    const AnalyzerPathGenerator::Polyline& getRightPolyline() const { return rightPathGenerator.getPolyline(); }
+    const AnalyzerPathGenerator::Polyline& getLeftPeakPolyline() const { return leftPeakGenerator.getPolyline(); }
+    const AnalyzerPathGenerator::Polyline& getRightPeakPolyline() const { return rightPeakGenerator.getPolyline(); }
+    
+    SpectrumSmoother& getSmoother() { return smoother; }
+    
+    void setAnalysisMode(AnalysisMode newMode);
+    
+    /** Drops any audio captured before the analyzer (re)started and clears the analysis history. */
+    void discardPendingAudio();
+    AnalysisMode getAnalysisMode() const { return analysisMode; }
+    
+    /** When set, every frame is written to the spectrogram and no polylines are generated. */
+    void setSpectrogram(Spectrogram* newSpectrogram) { spectrogram = newSpectrogram; }
+    bool isShowingPeaks() const { return smoother.getPeakHoldMode() != SpectrumSmoother::PeakHoldMode::Off; }
 private:
-    SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* fifo;
+    SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* leftFifo;
+    SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* rightFifo;
     
-    juce::AudioBuffer<float> monoBuffer;
+    juce::AudioBuffer<float> leftMonoBuffer, rightMonoBuffer;
+    juce::AudioBuffer<float> tempIncomingBuffer, tempIncomingRightBuffer;
+    
+    Decimator leftDecimator, rightDecimator;
+    std::vector<float> leftDecimated, rightDecimated;
+    double preparedSampleRate = 0.0, analysisSampleRate = 0.0;
+    int samplesSinceLastFrame = 0;
     
     FFTDataGenerator<std::vector<float>> fftDataGenerator;
+    std::vector<float> fftData;
+    
+    AnalysisMode analysisMode = AnalysisMode::MultiResolution;
+    MultiResolutionAnalyzer multiResolutionAnalyzer;
+    bool processMultiResolution(juce::Rectangle<float> fftBounds, double sampleRate);
     
-    AnalyzerPathGenerator<juce::Path> pathProducer;
+    SpectrumSmoother smoother;
+    Spectrogram* spectrogram = nullptr;
     
-    juce::Path fftPath;
+    AnalyzerPathGenerator leftPathGenerator, rightPathGenerator;
+    AnalyzerPathGenerator leftPeakGenerator, rightPeakGenerator;
 };
 
 struct ResponseCurveComponent: juce::Component,
 juce::AudioProcessorParameter::Listener,
-juce::Timer
+private juce::Timer
 {
     ResponseCurveComponent(SimpleEQAudioProcessor&);
     ~ResponseCurveComponent();
@@ -168,32 +349,113 @@ juce::Timer
 
     void parameterGestureChanged (int parameterIndex, bool gestureIsStarting) override { }
     
-    void timerCallback() override;
-    
     void paint (juce::Graphics& g) override;
     
     void resized() override;
     
-    void toggleAnalysisEnabled(bool enabled)
+    void toggleAnalysisEnabled(bool enabled);
+    
+    enum class AnalyzerView
+    {
+        Spectrum,
+        Spectrogram
+    };
+    
+    void setAnalyzerView(AnalyzerView newView);
+    
+    /** The displayed EQ response in dB at an x position in component coordinates. */
+    float getResponseInDecibelsAt(float x) const
+    {
+        return responseCurveEvaluator.getMagnitudeInDecibelsAt(x - responseCurveX);
+    }
+    
+    void setAnalyzerAveragingTime(float milliseconds)
+    {
+        pathProducer.getSmoother().setAveragingTime(milliseconds);
+    }
+    
+    void setAnalyzerPeakHold(SpectrumSmoother::PeakHoldMode mode, float holdMilliseconds, float decayDbPerSecond)
     {
-        shouldShowFFTAnalysis = enabled;
+        pathProducer.getSmoother().setPeakHold(mode, holdMilliseconds, decayDbPerSecond);
     }
     
+    void setAnalysisMode(PathProducer::AnalysisMode newMode);
+    PathProducer::AnalysisMode getAnalysisMode() const { return pathProducer.getAnalysisMode(); }
+    
 private:
     SimpleEQAudioProcessor& audioProcessor;
+    
+    /**
+     Set by parameterValueChanged, which hosts may call on the audio thread, so it does nothing
+     else. The message thread polls it: on every analyzer frame, or from the timer while the
+     analyzer is stopped.
+     */
     juce::Atomic<bool> parametersChanged { false };
     
+    /** Picks up parameter and sample rate changes. Message thread only. */
+    void updateCurveIfChanged();
+    void timerCallback() override { updateCurveIfChanged(); }
+    static constexpr int idlePollHz = 30;
+    juce::SharedResourcePointer<SharedResourcePool> sharedResources;
+    
     MonoChain monoChain;
+    BandBank displayBands;
+    std::array<BandParameters, BandBank::maxBands> bandParameters;
     
     void updateChain();
     
-    juce::Image background;
+    /** Re-evaluates the chain's magnitude response; only needed when the chain, sample rate or size change. */
+    void updateResponseCurve();
+    ResponseCurveEvaluator responseCurveEvaluator;
+    juce::Path responseCurve;
+    double curveSampleRate = 0.0;
+    float responseCurveX = 0.f;
+    
+    /**
+     The display is composed of three cached layers which are only re-rendered when invalidated:
+     the grid (size changes), the spectrum (new analyzer frames) and the response curve
+     (parameter, sample rate or size changes). The grid image comes from the shared pool.
+     */
+    SharedResourcePool::ReadOnlyImage background;
+    juce::Image spectrumLayer, responseCurveLayer;
+    bool gridLayerIsDirty = true, spectrumLayerIsDirty = true, responseCurveLayerIsDirty = true;
+    
+    AnalyzerView analyzerView = AnalyzerView::Spectrum;
+    Spectrogram spectrogram;
+    
+    void renderGridLayer();
+    void drawGrid(juce::Graphics& g);
+    void renderSpectrumLayer();
+    void renderResponseCurveLayer();
     
     juce::Rectangle<int> getRenderArea();
     
     juce::Rectangle<int> getAnalysisArea();
     
-    PathProducer leftPathProducer, rightPathProducer;
+    PathProducer pathProducer;
+    
+    juce::Path analyzerPath;
+    void strokePolyline(juce::Graphics& g, const AnalyzerPathGenerator::Polyline& polyline);
     
     bool shouldShowFFTAnalysis = true;
+    
+    /** Pulls new analyzer data; called by the frame pacer, in sync with the display where possible. */
+    void updateAnalyzer();
+    FramePacer analyzerPacer { *this, [this] { updateAnalyzer(); } };
+    
+    /** Runs the analyzer only while it is enabled and the component is on screen, and the poll timer otherwise. */
+    void updateAnalyzerPacerState();
+    
+    struct VisibilityWatcher : juce::ComponentMovementWatcher
+    {
+        VisibilityWatcher(ResponseCurveComponent& c) : juce::ComponentMovementWatcher(&c), owner(c) { }
+        
+        void componentMovedOrResized(bool, bool) override { }
+        void componentPeerChanged() override { owner.updateAnalyzerPacerState(); }
+        void componentVisibilityChanged() override { owner.updateAnalyzerPacerState(); }
+    private:
+        ResponseCurveComponent& owner;
+    };
+    
+    VisibilityWatcher visibilityWatcher;
 };
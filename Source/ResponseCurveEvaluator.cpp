@@ -0,0 +1,88 @@
+//
+//  ResponseCurveEvaluator.cpp
+//  SimpleEQ
+//
+
+#include "ResponseCurveEvaluator.h"
+
+void ResponseCurveEvaluator::prepare(int numColumns, double sampleRate)
+{
+    numColumns = juce::jmax(0, numColumns);
+    
+    if( numColumns == getNumColumns() && sampleRate == preparedSampleRate )
+        return;
+    
+    preparedSampleRate = sampleRate;
+    phi.resize(numColumns);
+    magnitudesDb.resize(numColumns);
+    
+    for( int i = 0; i < numColumns; ++i )
+    {
+        auto freq = juce::mapToLog10(double(i) / double(numColumns), 20.0, 20000.0);
+        auto s = sampleRate > 0.0 ? std::sin(juce::MathConstants<double>::pi * freq / sampleRate) : 0.0;
+        phi[i] = float(s * s);
+    }
+}
+
+void ResponseCurveEvaluator::clearSections()
+{
+    for( auto* v : { &n0, &n1, &n2, &d0, &d1, &d2 } )
+        v->clear();
+}
+
+void ResponseCurveEvaluator::addSection(const juce::dsp::IIR::Coefficients<float>& coefficients)
+{
+    // juce stores b0, b1, [b2,] a1, [a2] normalised so that a0 == 1
+    const auto* c = coefficients.coefficients.begin();
+    const auto order = coefficients.getFilterOrder();
+    jassert(order == 1 || order == 2);
+    
+    const double b0 = c[0];
+    const double b1 = c[1];
+    const double b2 = order == 2 ? c[2] : 0.0;
+    const double a1 = order == 2 ? c[3] : c[2];
+    const double a2 = order == 2 ? c[4] : 0.0;
+    
+    addSection(b0, b1, b2, a1, a2);
+}
+
+void ResponseCurveEvaluator::addSection(double b0, double b1, double b2, double a1, double a2)
+{
+    n0.push_back(float((b0 + b1 + b2) * (b0 + b1 + b2)));
+    n1.push_back(float(-4.0 * (b0 * b1 + 4.0 * b0 * b2 + b1 * b2)));
+    n2.push_back(float(16.0 * b0 * b2));
+    
+    d0.push_back(float((1.0 + a1 + a2) * (1.0 + a1 + a2)));
+    d1.push_back(float(-4.0 * (a1 + 4.0 * a2 + a1 * a2)));
+    d2.push_back(float(16.0 * a2));
+}
+
+void ResponseCurveEvaluator::evaluate()
+{
+    constexpr float decibelsPerOctave = 3.01029996f; // 10 * log10(2)
+    
+    const auto numColumns = getNumColumns();
+    const auto* p = phi.data();
+    auto* out = magnitudesDb.data();
+    
+    std::fill(magnitudesDb.begin(), magnitudesDb.end(), 0.f);
+    
+    // sections outer, columns inner, so the inner loop is a straight vectorisable sweep
+    for( size_t s = 0; s < n0.size(); ++s )
+        kernels->accumulateSectionResponse({ n0[s], n1[s], n2[s], d0[s], d1[s], d2[s] }, p, out, numColumns);
+    
+    for( int i = 0; i < numColumns; ++i )
+        out[i] *= decibelsPerOctave;
+}
+
+float ResponseCurveEvaluator::getMagnitudeInDecibelsAt(float column) const
+{
+    if( magnitudesDb.empty() )
+        return 0.f;
+    
+    column = juce::jlimit(0.f, float(magnitudesDb.size() - 1), column);
+    const auto i = (size_t)column;
+    const auto next = juce::jmin(i + 1, magnitudesDb.size() - 1);
+    
+    return juce::jmap(column - float(i), magnitudesDb[i], magnitudesDb[next]);
+}
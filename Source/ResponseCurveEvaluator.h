@@ -0,0 +1,48 @@
+//
+//  ResponseCurveEvaluator.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DspKernels.h"
+
+/**
+ Evaluates the combined magnitude response of a set of biquad sections at every pixel column.
+ 
+ Per-column sin^2(w/2) values are tabulated once for a given width and sample rate. Each section's
+ |H|^2 is then a ratio of two quadratics in that value, evaluated in float over all columns and
+ summed in the log domain. The result is kept so the curve and anything that needs to hit-test
+ against it read the same data.
+ */
+struct ResponseCurveEvaluator
+{
+    /** Rebuilds the frequency table if the column count or sample rate changed. */
+    void prepare(int numColumns, double sampleRate);
+    
+    void clearSections();
+    void addSection(const juce::dsp::IIR::Coefficients<float>& coefficients);
+    
+    /** A biquad given by its coefficients normalised so that a0 == 1. */
+    void addSection(double b0, double b1, double b2, double a1, double a2);
+    
+    /** Computes the response in dB for every column. */
+    void evaluate();
+    
+    int getNumColumns() const { return (int)phi.size(); }
+    const std::vector<float>& getMagnitudesInDecibels() const { return magnitudesDb; }
+    
+    /** The evaluated response at a column, interpolated between neighbouring columns. */
+    float getMagnitudeInDecibelsAt(float column) const;
+private:
+    // |H|^2 = (n0 + n1 phi + n2 phi^2) / (d0 + d1 phi + d2 phi^2),  phi = sin^2(w/2)
+    std::vector<float> n0, n1, n2, d0, d1, d2;
+    
+    std::vector<float> phi;
+    std::vector<float> magnitudesDb;
+    
+    double preparedSampleRate = 0.0;
+    
+    const DspKernels::KernelTable* kernels = &DspKernels::getKernels();
+};
@@ -14,8 +14,6 @@ void RotarySliderWithLabels::paint(juce::Graphics &g)
     auto startAng = degreesToRadians(180.f + 45.f);
     auto endAng = degreesToRadians(180.f - 45.f) + MathConstants<float>::twoPi;
     
-    auto range = getRange();
-    
     auto sliderBounds = getSliderBounds();
     
 //    g.setColour(Colours::red);
@@ -23,22 +21,81 @@ void RotarySliderWithLabels::paint(juce::Graphics &g)
 //    g.setColour(Colours::yellow);
 //    g.drawRect(sliderBounds);
     
-    auto sliderPosProportional = jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0);
     getLookAndFeel().drawRotarySlider(g,
                                       sliderBounds.getX(),
                                       sliderBounds.getY(),
                                       sliderBounds.getWidth(),
                                       sliderBounds.getHeight(),
-                                      sliderPosProportional,
+                                      getQuantizedSliderPosition(),
                                       startAng,
                                       endAng,
                                       *this);
     
+    updateLabelLayout();
+    
+    g.setColour(Colour(0u, 172u, 1u));
+    labelGlyphs.draw(g);
+}
+
+float RotarySliderWithLabels::getQuantizedSliderPosition() const
+{
+    auto range = getRange();
+    auto sliderPosProportional = juce::jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0);
+    
+    // snap the indicator to the parameter's step, so it only moves when the value visibly does
+    auto numSteps = double(maxIndicatorPositions);
+    if( getInterval() > 0.0 )
+        numSteps = juce::jlimit(1.0, numSteps, std::round(range.getLength() / getInterval()));
+    
+    return float(std::round(sliderPosProportional * numSteps) / numSteps);
+}
+
+const RotarySliderWithLabels::TextLayout& RotarySliderWithLabels::getValueTextLayout()
+{
+    if( getValue() == valueTextValue )
+        return valueText;
+    
+    valueTextValue = getValue();
+    
+    auto text = getDisplayString();
+    if( text == valueText.text && valueText.glyphs.getNumGlyphs() > 0 )
+        return valueText;
+    
+    juce::Font font(getTextHeight());
+    
+    valueText.text = text;
+    valueText.width = font.getStringWidthFloat(text);
+    valueText.glyphs.clear();
+    valueText.glyphs.addFittedText(font, text,
+                                   0, 0, valueText.width + 4, getTextHeight() + 2,
+                                   juce::Justification::centred, 1);
+    
+    return valueText;
+}
+
+void RotarySliderWithLabels::updateLabelLayout()
+{
+    using namespace juce;
+    
+    auto labelsUnchanged = labels.size() == layoutLabels.size();
+    for( int i = 0; labelsUnchanged && i < labels.size(); ++i )
+        labelsUnchanged = labels[i].pos == layoutLabels[i].pos && labels[i].label == layoutLabels[i].label;
+    
+    if( labelsUnchanged && labelLayoutBounds == getLocalBounds() )
+        return;
+    
+    layoutLabels = labels;
+    labelLayoutBounds = getLocalBounds();
+    labelGlyphs.clear();
+    
+    auto startAng = degreesToRadians(180.f + 45.f);
+    auto endAng = degreesToRadians(180.f - 45.f) + MathConstants<float>::twoPi;
+    
+    auto sliderBounds = getSliderBounds();
     auto center = sliderBounds.toFloat().getCentre();
     auto radius = sliderBounds.getWidth() * 0.5f;
     
-    g.setColour(Colour(0u, 172u, 1u));
-    g.setFont(getTextHeight());
+    Font font(getTextHeight());
     
     auto numChoices = labels.size();
     for ( int i = 0; i < numChoices; ++i )
@@ -53,11 +110,14 @@ void RotarySliderWithLabels::paint(juce::Graphics &g)
         
         Rectangle<float> r;
         auto str = labels[i].label;
-        r.setSize(g.getCurrentFont().getStringWidth(str), getTextHeight());
+        r.setSize(font.getStringWidth(str), getTextHeight());
         r.setCentre(c);
         r.setY(r.getY() + getTextHeight());
         
-        g.drawFittedText(str, r.toNearestInt(), juce::Justification::centred, 1);
+        auto area = r.toNearestInt();
+        labelGlyphs.addFittedText(font, str,
+                                  area.getX(), area.getY(), area.getWidth(), area.getHeight(),
+                                  juce::Justification::centred, 1);
     }
 }
 
@@ -17,7 +17,7 @@ struct RotarySliderWithLabels : juce::Slider
     param(&rap),
     suffix(unitSuffix)
     {
-        setLookAndFeel(&lnf);
+        setLookAndFeel(&lnf.get());
     }
     
     ~RotarySliderWithLabels()
@@ -37,8 +37,31 @@ struct RotarySliderWithLabels : juce::Slider
     juce::Rectangle<int> getSliderBounds() const;
     int getTextHeight() const { return 14; }
     juce::String getDisplayString() const;
+    
+    /** The value readout's glyphs, laid out from the origin; rebuilt only when the text changes. */
+    struct TextLayout
+    {
+        juce::String text;
+        juce::GlyphArrangement glyphs;
+        float width = 0.f;
+    };
+    
+    const TextLayout& getValueTextLayout();
+    
+    /** Indicator positions per rotation, or the parameter's step count if that is coarser. */
+    static constexpr int maxIndicatorPositions = 270;
 private:
-    LookAndFeel lnf;
+    juce::SharedResourcePointer<LookAndFeel> lnf;
     juce::RangedAudioParameter* param;
     juce::String suffix;
+    
+    TextLayout valueText;
+    double valueTextValue = std::numeric_limits<double>::quiet_NaN();
+    
+    juce::Array<LabelPos> layoutLabels;
+    juce::Rectangle<int> labelLayoutBounds;
+    juce::GlyphArrangement labelGlyphs;
+    
+    void updateLabelLayout();
+    float getQuantizedSliderPosition() const;
 };
@@ -0,0 +1,84 @@
+//
+//  SharedResourcePool.cpp
+//  SimpleEQ
+//
+
+#include "SharedResourcePool.h"
+
+std::shared_ptr<const juce::dsp::FFT> SharedResourcePool::getFFT(int order)
+{
+    const juce::ScopedLock sl(lock);
+    
+    auto& fft = ffts[order];
+    if( fft == nullptr )
+        fft = std::make_shared<const juce::dsp::FFT>(order);
+    
+    return fft;
+}
+
+std::shared_ptr<const std::vector<float>> SharedResourcePool::getWindowTable(int size)
+{
+    const juce::ScopedLock sl(lock);
+    
+    auto& table = windowTables[size];
+    if( table == nullptr )
+    {
+        auto newTable = std::make_shared<std::vector<float>>(size, 0.f);
+        juce::dsp::WindowingFunction<float>::fillWindowingTables(newTable->data(),
+                                                                 (size_t)size,
+                                                                 juce::dsp::WindowingFunction<float>::blackmanHarris);
+        table = newTable;
+    }
+    
+    return table;
+}
+
+ChainDesign SharedResourcePool::getChainDesign(const ChainSettings& chainSettings, double sampleRate)
+{
+    const juce::ScopedLock sl(lock);
+    
+    const DesignKey key { chainSettings.lowCutFreq, (int)chainSettings.lowCutSlope,
+                          chainSettings.highCutFreq, (int)chainSettings.highCutSlope,
+                          chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDecibels,
+                          sampleRate };
+    
+    if( auto it = chainDesigns.find(key); it != chainDesigns.end() )
+        return it->second;
+    
+    if( chainDesigns.size() >= maxCachedDesigns )
+    {
+        chainDesigns.erase(chainDesignOrder.front());
+        chainDesignOrder.pop_front();
+    }
+    
+    auto design = makeChainDesign(chainSettings, sampleRate);
+    chainDesigns.emplace(key, design);
+    chainDesignOrder.push_back(key);
+    return design;
+}
+
+SharedResourcePool::ReadOnlyImage SharedResourcePool::getGridImage(int width, int height, const std::function<void(juce::Graphics&)>& render)
+{
+    const juce::ScopedLock sl(lock);
+    
+    const auto size = std::make_pair(width, height);
+    
+    for( const auto& entry : gridImages )
+    {
+        if( entry.first == size )
+            return ReadOnlyImage(entry.second);
+    }
+    
+    juce::Image image(juce::Image::PixelFormat::RGB, width, height, true);
+    
+    {
+        juce::Graphics g(image);
+        render(g);
+    }
+    
+    if( gridImages.size() >= maxCachedGridImages )
+        gridImages.pop_front();
+    
+    gridImages.emplace_back(size, image);
+    return ReadOnlyImage(image);
+}
@@ -0,0 +1,68 @@
+//
+//  SharedResourcePool.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <deque>
+#include "PluginProcessor.h"
+
+/**
+ Resources that every plugin instance in the host process can share: FFT plans, window tables,
+ filter designs and the response display's grid image.
+ 
+ Access it through juce::SharedResourcePointer<SharedResourcePool>; the pool is created by the
+ first instance that needs it and destroyed with the last one, so memory and editor-open time
+ don't scale with the number of instances. It is meant for the message thread only.
+ */
+struct SharedResourcePool
+{
+    std::shared_ptr<const juce::dsp::FFT> getFFT(int order);
+    
+    /** A normalised Blackman-Harris table. */
+    std::shared_ptr<const std::vector<float>> getWindowTable(int size);
+    
+    /**
+     The main chain designed by makeChainDesign, the same code the processor designs with, so the
+     displayed curve is exactly what the audio runs through. Only the filter coefficients are
+     meant to be used, as designs are shared between settings that differ only in their bypass
+     states or filter engine.
+     */
+    ChainDesign getChainDesign(const ChainSettings& chainSettings, double sampleRate);
+    
+    /**
+     An image that every instance draws from, so it can't be drawn into; a caller that needs to
+     modify it has to take a copy.
+     */
+    struct ReadOnlyImage
+    {
+        ReadOnlyImage() = default;
+        explicit ReadOnlyImage(const juce::Image& imageToShare) : image(imageToShare) { }
+        
+        bool isNull() const { return image.isNull(); }
+        void drawAt(juce::Graphics& g, int x, int y) const { g.drawImageAt(image, x, y); }
+        juce::Image createCopy() const { return image.createCopy(); }
+    private:
+        juce::Image image;
+    };
+    
+    /** Returns the cached image for this size, calling render to draw it on a cache miss. */
+    ReadOnlyImage getGridImage(int width, int height, const std::function<void(juce::Graphics&)>& render);
+private:
+    juce::CriticalSection lock;
+    
+    std::map<int, std::shared_ptr<const juce::dsp::FFT>> ffts;
+    std::map<int, std::shared_ptr<const std::vector<float>>> windowTables;
+    
+    /** Everything a ChainDesign's coefficients depend on. */
+    using DesignKey = std::tuple<float, int, float, int, float, float, float, double>;
+    
+    static constexpr size_t maxCachedDesigns = 64;
+    std::map<DesignKey, ChainDesign> chainDesigns;
+    std::deque<DesignKey> chainDesignOrder;
+    
+    static constexpr size_t maxCachedGridImages = 4;
+    std::deque<std::pair<std::pair<int, int>, juce::Image>> gridImages;
+};
@@ -0,0 +1,121 @@
+//
+//  Spectrogram.cpp
+//  SimpleEQ
+//
+
+#include "Spectrogram.h"
+
+Spectrogram::Spectrogram()
+{
+    using namespace juce;
+    
+    ColourGradient gradient;
+    gradient.addColour(0.0, Colours::black);
+    gradient.addColour(0.25, Colour(30u, 10u, 90u));
+    gradient.addColour(0.5, Colour(97u, 18u, 167u));
+    gradient.addColour(0.75, Colour(255u, 154u, 1u));
+    gradient.addColour(1.0, Colours::lightyellow);
+    
+    for( int i = 0; i < colourLutSize; ++i )
+        colourLut[i] = gradient.getColourAtPosition(double(i) / (colourLutSize - 1)).getPixelARGB();
+}
+
+void Spectrogram::setBounds(juce::Rectangle<int> newBounds)
+{
+    if( newBounds == bounds )
+        return;
+    
+    bounds = newBounds;
+    
+    if( bounds.isEmpty() )
+    {
+        history = {};
+        return;
+    }
+    
+    history = juce::Image(juce::Image::PixelFormat::ARGB, bounds.getWidth(), bounds.getHeight(), false);
+    mappedNumBins = 0;
+    clear();
+}
+
+void Spectrogram::clear()
+{
+    writeColumn = 0;
+    
+    if( history.isValid() )
+        history.clear(history.getBounds(), juce::Colours::black);
+}
+
+void Spectrogram::updateRowMapping(int numBins, float binWidth)
+{
+    const auto numRows = history.getHeight();
+    
+    if( numBins == mappedNumBins && binWidth == mappedBinWidth && (int)rowBins.size() == numRows )
+        return;
+    
+    mappedNumBins = numBins;
+    mappedBinWidth = binWidth;
+    rowBins.resize(numRows);
+    
+    for( int row = 0; row < numRows; ++row )
+    {
+        auto lowFreq = juce::mapToLog10(1.f - float(row + 1) / numRows, 20.f, 20000.f);
+        auto highFreq = juce::mapToLog10(1.f - float(row) / numRows, 20.f, 20000.f);
+        
+        auto first = juce::jlimit(1, numBins - 1, (int)std::floor(lowFreq / binWidth));
+        auto last = juce::jlimit(first + 1, numBins, (int)std::ceil(highFreq / binWidth));
+        
+        rowBins[row] = { first, last };
+    }
+}
+
+void Spectrogram::pushFrame(const float* leftDb,
+                            const float* rightDb,
+                            int numBins,
+                            float binWidth,
+                            float negativeInfinity)
+{
+    if( !history.isValid() || numBins < 2 )
+        return;
+    
+    updateRowMapping(numBins, binWidth);
+    
+    const auto scale = float(colourLutSize - 1) / -negativeInfinity;
+    
+    juce::Image::BitmapData column(history, writeColumn, 0, 1, history.getHeight(), juce::Image::BitmapData::writeOnly);
+    
+    for( int row = 0; row < (int)rowBins.size(); ++row )
+    {
+        auto level = negativeInfinity;
+        
+        for( int bin = rowBins[row].first; bin < rowBins[row].second; ++bin )
+            level = juce::jmax(level, leftDb[bin], rightDb[bin]);
+        
+        auto index = juce::jlimit(0, colourLutSize - 1, int((level - negativeInfinity) * scale));
+        *reinterpret_cast<juce::PixelARGB*>(column.getPixelPointer(0, row)) = colourLut[index];
+    }
+    
+    writeColumn = (writeColumn + 1) % history.getWidth();
+}
+
+void Spectrogram::draw(juce::Graphics& g) const
+{
+    if( !history.isValid() )
+        return;
+    
+    // the oldest column is at writeColumn, so the image is drawn in two pieces around it
+    const auto width = history.getWidth();
+    const auto height = history.getHeight();
+    const auto olderWidth = width - writeColumn;
+    
+    g.drawImage(history,
+                bounds.getX(), bounds.getY(), olderWidth, height,
+                writeColumn, 0, olderWidth, height);
+    
+    if( writeColumn > 0 )
+    {
+        g.drawImage(history,
+                    bounds.getX() + olderWidth, bounds.getY(), writeColumn, height,
+                    0, 0, writeColumn, height);
+    }
+}
@@ -0,0 +1,48 @@
+//
+//  Spectrogram.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ A scrolling spectrogram backed by a ring-buffered image.
+ 
+ Every FFT frame becomes one column of the image, coloured through a precomputed lookup table,
+ and the image is never redrawn: the display scrolls by splitting the blit at the write position.
+ The cost per frame is a single column write regardless of how much history is shown.
+ */
+struct Spectrogram
+{
+    Spectrogram();
+    
+    /** Sets the area the spectrogram is drawn into; one column of history per pixel. */
+    void setBounds(juce::Rectangle<int> newBounds);
+    
+    void clear();
+    
+    /** Writes one column from the louder of the two channels' dB frames. */
+    void pushFrame(const float* leftDb,
+                   const float* rightDb,
+                   int numBins,
+                   float binWidth,
+                   float negativeInfinity);
+    
+    void draw(juce::Graphics& g) const;
+private:
+    juce::Rectangle<int> bounds;
+    juce::Image history;
+    int writeColumn = 0;
+    
+    /** The range of bins [first, last) covered by each pixel row, top row first. */
+    std::vector<std::pair<int, int>> rowBins;
+    int mappedNumBins = 0;
+    float mappedBinWidth = 0.f;
+    
+    static constexpr int colourLutSize = 256;
+    std::array<juce::PixelARGB, colourLutSize> colourLut;
+    
+    void updateRowMapping(int numBins, float binWidth);
+};
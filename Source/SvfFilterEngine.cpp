@@ -0,0 +1,246 @@
+//
+//  SvfFilterEngine.cpp
+//  SimpleEQ
+//
+
+#include "SvfFilterEngine.h"
+#include "CoefficientDesign.h"
+
+void SvfFilterEngine::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void SvfFilterEngine::reset()
+{
+    for( auto& channelStates : states )
+        channelStates.fill({});
+}
+
+float SvfFilterEngine::prewarp(float freq) const
+{
+    return prewarpFrequency(juce::jmax(10.f, freq), sampleRate);
+}
+
+SvfFilterEngine::Coefficients SvfFilterEngine::Tuning::toCoefficients() const
+{
+    Coefficients c;
+    c.a1 = 1.f / (1.f + g * (g + k));
+    c.a2 = g * c.a1;
+    c.a3 = g * c.a2;
+    c.m0 = m0;
+    c.m1 = m1;
+    c.m2 = m2;
+    return c;
+}
+
+void SvfFilterEngine::Section::advance(int numSamples)
+{
+    current.g += increment.g * numSamples;
+    current.k += increment.k * numSamples;
+    current.m0 += increment.m0 * numSamples;
+    current.m1 += increment.m1 * numSamples;
+    current.m2 += increment.m2 * numSamples;
+}
+
+void SvfFilterEngine::setTarget(Section& section, const Tuning& tuning, bool jump)
+{
+    section.target = tuning;
+    section.coefficients = tuning.toCoefficients();
+    section.jumpToTarget = section.jumpToTarget || jump;
+}
+
+void SvfFilterEngine::setCutSections(int firstSection, float freq, int order, bool isHighPass, bool jump)
+{
+    const auto numSections = juce::jlimit(1, maxCutSections, order / 2);
+    const auto g = prewarp(freq);
+    
+    for( int i = 0; i < numSections; ++i )
+    {
+        Tuning tuning;
+        tuning.g = g;
+        tuning.k = Butterworth::getDamping(numSections, i);
+        
+        // high = x - k * band - low
+        tuning.m0 = isHighPass ? 1.f : 0.f;
+        tuning.m1 = isHighPass ? -tuning.k : 0.f;
+        tuning.m2 = isHighPass ? -1.f : 1.f;
+        
+        setTarget(sections[firstSection + i], tuning, jump);
+    }
+}
+
+void SvfFilterEngine::setLowCut(float freq, int order, bool bypassed)
+{
+    if( sampleRate <= 0.0 )
+        return;
+    
+    const auto numSections = juce::jlimit(1, maxCutSections, order / 2);
+    const auto jump = numSections != numLowCutSections || bypassed != lowCutBypassed;
+    
+    setCutSections(LowCutFirst, freq, order, true, jump);
+    numLowCutSections = numSections;
+    lowCutBypassed = bypassed;
+}
+
+void SvfFilterEngine::setHighCut(float freq, int order, bool bypassed)
+{
+    if( sampleRate <= 0.0 )
+        return;
+    
+    const auto numSections = juce::jlimit(1, maxCutSections, order / 2);
+    const auto jump = numSections != numHighCutSections || bypassed != highCutBypassed;
+    
+    setCutSections(HighCutFirst, freq, order, false, jump);
+    numHighCutSections = numSections;
+    highCutBypassed = bypassed;
+}
+
+void SvfFilterEngine::setPeak(float freq, float quality, float gainInDecibels, bool bypassed)
+{
+    if( sampleRate <= 0.0 )
+        return;
+    
+    // the same bell as the RBJ peak filter: A = 10^(dB/40), k = 1 / (Q * A)
+    const auto A = std::pow(10.f, gainInDecibels / 40.f);
+    
+    Tuning tuning;
+    tuning.g = prewarp(freq);
+    tuning.k = 1.f / (juce::jmax(0.025f, quality) * A);
+    tuning.m0 = 1.f;
+    tuning.m1 = tuning.k * (A * A - 1.f);
+    tuning.m2 = 0.f;
+    
+    setTarget(sections[PeakSection], tuning, bypassed != peakBypassed);
+    peakBypassed = bypassed;
+}
+
+void SvfFilterEngine::rampToTargets(int numSamples)
+{
+    rampSamplesRemaining = juce::jmax(0, numSamples);
+    
+    const auto inverseLength = rampSamplesRemaining > 0 ? 1.f / (float)rampSamplesRemaining : 0.f;
+    
+    for( auto& section : sections )
+    {
+        if( rampSamplesRemaining == 0 || section.jumpToTarget )
+        {
+            section.current = section.target;
+            section.increment = { 0.f, 0.f, 0.f, 0.f, 0.f };
+        }
+        else
+        {
+            section.increment.g = (section.target.g - section.current.g) * inverseLength;
+            section.increment.k = (section.target.k - section.current.k) * inverseLength;
+            section.increment.m0 = (section.target.m0 - section.current.m0) * inverseLength;
+            section.increment.m1 = (section.target.m1 - section.current.m1) * inverseLength;
+            section.increment.m2 = (section.target.m2 - section.current.m2) * inverseLength;
+        }
+        
+        section.jumpToTarget = false;
+    }
+}
+
+void SvfFilterEngine::processSection(int sectionIndex, float* left, float* right, int numSamples, int numRampSamples)
+{
+    auto& section = sections[sectionIndex];
+    auto& l = states[0][sectionIndex];
+    auto* r = right != nullptr ? &states[1][sectionIndex] : nullptr;
+    
+    auto tick = [](const Coefficients& c, State& s, float x)
+    {
+        const auto v3 = x - s.ic2;
+        const auto v1 = c.a1 * s.ic1 + c.a2 * v3;
+        const auto v2 = s.ic2 + c.a2 * s.ic1 + c.a3 * v3;
+        
+        s.ic1 = 2.f * v1 - s.ic1;
+        s.ic2 = 2.f * v2 - s.ic2;
+        
+        return c.m0 * x + c.m1 * v1 + c.m2 * v2;
+    };
+    
+    // the ramp: coefficients are derived from the stepped tuning at every sample
+    for( int n = 0; n < numRampSamples; ++n )
+    {
+        section.advance(1);
+        const auto c = section.current.toCoefficients();
+        
+        left[n] = tick(c, l, left[n]);
+        
+        if( r != nullptr )
+            right[n] = tick(c, *r, right[n]);
+    }
+    
+    const auto& c = section.coefficients;
+    
+    if( r != nullptr )
+    {
+        for( int n = numRampSamples; n < numSamples; ++n )
+        {
+            left[n] = tick(c, l, left[n]);
+            right[n] = tick(c, *r, right[n]);
+        }
+    }
+    else
+    {
+        for( int n = numRampSamples; n < numSamples; ++n )
+            left[n] = tick(c, l, left[n]);
+    }
+}
+
+void SvfFilterEngine::process(juce::AudioBuffer<float>& buffer)
+{
+    const auto numChannels = juce::jmin(buffer.getNumChannels(), maxChannels);
+    const auto numSamples = buffer.getNumSamples();
+    
+    if( numChannels == 0 )
+        return;
+    
+    auto* left = buffer.getWritePointer(0);
+    auto* right = numChannels > 1 ? buffer.getWritePointer(1) : nullptr;
+    
+    const auto numRampSamples = juce::jmin(numSamples, rampSamplesRemaining);
+    std::array<bool, NumSections> processed {};
+    
+    auto run = [&](int sectionIndex)
+    {
+        processSection(sectionIndex, left, right, numSamples, numRampSamples);
+        processed[(size_t)sectionIndex] = true;
+    };
+    
+    // same order as MonoChain: low cut, peak, high cut
+    if( !lowCutBypassed )
+    {
+        for( int i = 0; i < numLowCutSections; ++i )
+            run(LowCutFirst + i);
+    }
+    
+    if( !peakBypassed )
+        run(PeakSection);
+    
+    if( !highCutBypassed )
+    {
+        for( int i = 0; i < numHighCutSections; ++i )
+            run(HighCutFirst + i);
+    }
+    
+    // sections that sat this block out still move along their ramps
+    for( size_t i = 0; i < sections.size(); ++i )
+    {
+        if( !processed[i] )
+            sections[i].advance(numRampSamples);
+    }
+    
+    rampSamplesRemaining -= numRampSamples;
+    
+    // land exactly on the targets rather than wherever the accumulated steps ended up
+    if( numRampSamples > 0 && rampSamplesRemaining == 0 )
+    {
+        for( auto& section : sections )
+        {
+            section.current = section.target;
+            section.increment = { 0.f, 0.f, 0.f, 0.f, 0.f };
+        }
+    }
+}
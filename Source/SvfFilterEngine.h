@@ -0,0 +1,100 @@
+//
+//  SvfFilterEngine.h
+//  SimpleEQ
+//
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ The low-cut, peak and high-cut responses built from topology-preserving (zero-delay feedback)
+ state-variable filters instead of direct-form biquads.
+
+ The integrator states are physical quantities that stay meaningful when the cutoff or gain moves,
+ so coefficients can change every sample without the transients a direct-form filter produces.
+ Each filter is tuned by a single prewarped tan; a Butterworth cascade shares that one value across
+ all its sections and only the damping differs. The responses are identical to the bilinear
+ designs used by the direct-form chain.
+
+ New settings are ramped to rather than switched: every section's g, k and output mix move
+ linearly, one step per sample, and a1..a3 are derived from g and k at every step. Each
+ intermediate section is a valid SVF, so the ramp is stable whatever its end points are.
+ */
+struct SvfFilterEngine
+{
+    static constexpr int maxChannels = 2;
+    static constexpr int maxCutSections = 4;
+    
+    void prepare(double sampleRate);
+    void reset();
+    
+    /**
+     order is 2, 4, 6 or 8. The setters only set targets; rampToTargets() applies them. A filter
+     whose order or bypass state changes jumps straight to its new target, as a ramp between
+     different section counts means nothing.
+     */
+    void setLowCut(float freq, int order, bool bypassed);
+    void setPeak(float freq, float quality, float gainInDecibels, bool bypassed);
+    void setHighCut(float freq, int order, bool bypassed);
+    
+    /** Moves every section to its target over the next numSamples processed samples; 0 jumps. */
+    void rampToTargets(int numSamples);
+    
+    /** Processes up to two channels in place. */
+    void process(juce::AudioBuffer<float>& buffer);
+private:
+    /** Simper's trapezoidal SVF: y = m0 * x + m1 * band + m2 * low. */
+    struct Coefficients
+    {
+        float a1 = 0.f, a2 = 0.f, a3 = 0.f;
+        float m0 = 1.f, m1 = 0.f, m2 = 0.f;
+    };
+    
+    /** What a section is tuned with; these are the values that are ramped. */
+    struct Tuning
+    {
+        float g = 0.f, k = 1.f;
+        float m0 = 1.f, m1 = 0.f, m2 = 0.f;
+        
+        Coefficients toCoefficients() const;
+    };
+    
+    struct Section
+    {
+        Tuning target, current, increment;
+        Coefficients coefficients; // of target
+        bool jumpToTarget = true;
+        
+        void advance(int numSamples);
+    };
+    
+    struct State
+    {
+        float ic1 = 0.f, ic2 = 0.f;
+    };
+    
+    enum SectionIndex
+    {
+        LowCutFirst = 0,
+        PeakSection = maxCutSections,
+        HighCutFirst = maxCutSections + 1,
+        NumSections = 2 * maxCutSections + 1
+    };
+    
+    double sampleRate = 44100.0;
+    
+    std::array<Section, NumSections> sections;
+    std::array<std::array<State, NumSections>, maxChannels> states;
+    
+    int numLowCutSections = 1, numHighCutSections = 1;
+    bool lowCutBypassed = false, peakBypassed = false, highCutBypassed = false;
+    int rampSamplesRemaining = 0;
+    
+    float prewarp(float freq) const;
+    static void setTarget(Section& section, const Tuning& tuning, bool jump);
+    void setCutSections(int firstSection, float freq, int order, bool isHighPass, bool jump);
+    
+    void processSection(int sectionIndex, float* left, float* right, int numSamples, int numRampSamples);
+};
@@ -31,3 +31,8 @@ struct AnalyzerButton : juce::ToggleButton
     
     juce::Path randomPath;
 };
+
+struct SpectrogramButton : juce::ToggleButton { };
+
+/** Flips between the A and B snapshots. */
+struct CompareButton : juce::ToggleButton { };